@@ -13,6 +13,10 @@
 
 #include "Matrix1000Patch.h"
 #include "Matrix1000_GlobalSettings.h"
+#include "Matrix1000StreamTracker.h"
+#include "Matrix1000Library.h"
+#include "Matrix1000Detector.h"
+#include "Matrix1000Instrumentation.h"
 
 //#include "Matrix1000BCR.h"
 //#include "BCR2000.h"
@@ -20,6 +24,11 @@
 #include "MidiHelpers.h"
 
 #include <set>
+#include <bitset>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
 //#include "BCR2000_Presets.h"
 
 namespace midikraft {
@@ -34,6 +43,7 @@ namespace midikraft {
 		uint8 SINGLE_PATCH_DATA = 0x01;
 		uint8 REQUEST_DATA = 0x04;
 		uint8 SET_BANK = 0x0a;
+		uint8 REMOTE_PARAMETER_EDIT = 0x06;
 		uint8 PARAMETER_EDIT = 0x0b;
 		uint8 BANK_UNLOCK = 0x0c;
 		uint8 SINGLE_PATCH_TO_EDIT_BUFFER = 0x0d;
@@ -42,10 +52,78 @@ namespace midikraft {
 
 	// Definition for the "unused" data bytes inside the sysex of the Matrix 1000
 	// These unused bytes need to be blanked for us to compare patches in order to detect duplicates
-	std::vector<Range<int>> kMatrix1000BlankOutZones = {
+	const std::vector<Range<int>> kMatrix1000BlankOutZones = {
 		{0, 8} // This is the ASCII name, 8 character. The Matrix1000 will never display it, but I think a Matrix6 will
 	};
 
+	const int kMatrix1000MasterDataSize = 172; // Number of bytes of the unescaped master parameter data
+	const int kMatrix1000PatchDumpSize = 4 + 2 * kMatrix1000PatchDataSize + 1; // Sysex data of a program dump without F0 and F7: header, nibbles and checksum
+
+	// Calls the function for each [start, end) range of the patch data outside of the blank out zones, which must be sorted
+	template<typename TFunction> static void forEachVoiceRelevantRange(size_t size, TFunction function) {
+		size_t start = 0;
+		for (auto const &zone : kMatrix1000BlankOutZones) {
+			size_t zoneStart = std::min((size_t)zone.getStart(), size);
+			if (zoneStart > start) {
+				function(start, zoneStart);
+			}
+			start = std::max(start, std::min((size_t)zone.getEnd(), size));
+		}
+		if (start < size) {
+			function(start, size);
+		}
+	}
+
+	static bool sameVoiceData(const uint8 *a, size_t sizeA, const uint8 *b, size_t sizeB) {
+		if (sizeA != sizeB) {
+			return false;
+		}
+		bool same = true;
+		forEachVoiceRelevantRange(sizeA, [&](size_t start, size_t end) {
+			same = same && memcmp(a + start, b + start, end - start) == 0;
+		});
+		return same;
+	}
+
+	// Hash all patches, and only compare the bytes of those that land in the same bucket to rule out collisions
+	template<typename TDataAccess> static std::vector<std::vector<size_t>> findDuplicatesOf(size_t numberOfPatches, TDataAccess dataOf) {
+		std::unordered_map<uint64, std::vector<size_t>> buckets;
+		buckets.reserve(numberOfPatches);
+		for (size_t i = 0; i < numberOfPatches; i++) {
+			auto data = dataOf(i);
+			buckets[Matrix1000::voiceFingerprint(data.first, data.second)].push_back(i);
+		}
+
+		std::vector<std::vector<size_t>> result;
+		for (auto const &bucket : buckets) {
+			if (bucket.second.size() < 2) {
+				continue;
+			}
+			// Usually the bucket is one group. Only in case of a true hash collision this loop splits it up
+			std::vector<size_t> remaining = bucket.second;
+			while (remaining.size() > 1) {
+				std::vector<size_t> group, others;
+				auto first = dataOf(remaining.front());
+				for (auto index : remaining) {
+					auto data = dataOf(index);
+					if (sameVoiceData(first.first, first.second, data.first, data.second)) {
+						group.push_back(index);
+					}
+					else {
+						others.push_back(index);
+					}
+				}
+				if (group.size() > 1) {
+					result.push_back(group);
+				}
+				remaining.swap(others);
+			}
+		}
+		// Make the result independent of the hash map's iteration order
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
 	struct Matrix1000GlobalSettingDefinition {
 		int sysexIndex;
 		TypedNamedValue typedNamedValue;
@@ -85,12 +163,23 @@ namespace midikraft {
 			{ 171, { "Memory Protect Enable", "General", false } },
 		};
 	};
-	std::shared_ptr<Matrix1000GlobalSettings> gMatrix1000GlobalSettings;
-	std::shared_ptr<Matrix1000GlobalSettings> sMatrix1000GlobalSettings() {
-		if (!gMatrix1000GlobalSettings) {
-			gMatrix1000GlobalSettings = std::make_shared<Matrix1000GlobalSettings>();
+	// Built on first use, which is thread safe for a function local static, and never modified afterwards
+	Matrix1000GlobalSettings const &sMatrix1000GlobalSettings() {
+		static const Matrix1000GlobalSettings kGlobalSettings;
+		return kGlobalSettings;
+	}
+
+	// The value shown in the UI for a setting, from the unescaped master data
+	static int globalSettingValue(Matrix1000GlobalSettingDefinition const &def, std::vector<uint8> const &masterData) {
+		int intValue = masterData[def.sysexIndex] + def.displayOffset;
+		if (def.isTwosComplement) {
+			// Very special code that only works because there are just two fields in the global settings that need it
+			// Master transpose and Master tuning
+			if (intValue > 127) {
+				intValue = (int8)intValue;
+			}
 		}
-		return gMatrix1000GlobalSettings;
+		return intValue;
 	}
 
 	juce::MidiMessage Matrix1000::requestEditBufferDump() const
@@ -126,11 +215,118 @@ namespace midikraft {
 		return MidiHelpers::sysexMessage({ MIDI_ID.OBERHEIM, MIDI_ID.MATRIX6_1000, MIDI_COMMAND.BANK_UNLOCK });
 	}
 
+	MidiMessage Matrix1000::createRemoteParameterEdit(int controller, int value) const
+	{
+		jassert(controller >= 0 && controller < 128);
+		return MidiHelpers::sysexMessage({ MIDI_ID.OBERHEIM, MIDI_ID.MATRIX6_1000, MIDI_COMMAND.REMOTE_PARAMETER_EDIT, (uint8)controller, (uint8)(value & 0x7f) });
+	}
+
+	MidiMessage Matrix1000::createModulationBusEdit(int bus, int source, int amount, int destination) const
+	{
+		jassert(bus >= 0 && bus < 10);
+		return MidiHelpers::sysexMessage({ MIDI_ID.OBERHEIM, MIDI_ID.MATRIX6_1000, MIDI_COMMAND.PARAMETER_EDIT, (uint8)bus, (uint8)source, (uint8)(amount & 0x7f), (uint8)destination });
+	}
+
+	std::vector<MidiMessage> Matrix1000::createParameterNRPN(Matrix1000ParamDefinition const &param, int value) const
+	{
+		// Same mapping as the BCR2000 NRPN setup - everything but the 7 bit values is offset by 0x40
+		int nrpnValue = value;
+		if (abs(param.bits()) < 7 || param.bits() < 0) {
+			nrpnValue += 0x40;
+		}
+		return MidiHelpers::generateRPN(channel().toOneBasedInt(), param.controller(), nrpnValue & 0x7f, true, false, false);
+	}
+
+	Matrix1000::EditPlan Matrix1000::createEditPlan(Matrix1000Patch const &current, Matrix1000Patch const &next, bool useNRPN) const
+	{
+		const int kFirstVoiceByte = 8; // The name is not transmitted
+		const int kFirstModulationBusIndex = 104;
+		const int kFullDumpSize = 2 + 4 + 2 * kMatrix1000PatchDataSize + 1; // F0 F7, header, nibbles and checksum
+
+		EditPlan plan = { false, {}, {}, 0 };
+		if (current.data().size() != kMatrix1000PatchDataSize || next.data().size() != kMatrix1000PatchDataSize) {
+			jassertfalse;
+			plan.isFullDump = true;
+		}
+
+		std::bitset<10> busesChanged;
+		for (int i = kFirstVoiceByte; i < kMatrix1000PatchDataSize && !plan.isFullDump; i++) {
+			if (current.at(i) == next.at(i)) {
+				continue;
+			}
+			auto const &params = Matrix1000ParamDefinition::definitionsAtSysexIndex(i);
+			if (params.empty()) {
+				// No single value message can change this byte
+				plan.isFullDump = true;
+				break;
+			}
+			for (auto param : params) {
+				int before, after;
+				if (param->valueInPatch(current, before) && param->valueInPatch(next, after) && before != after) {
+					plan.changedParameters.push_back(param->id());
+				}
+			}
+
+			if (i >= kFirstModulationBusIndex) {
+				// All three values of a bus go into one message, so send that once all bytes have been looked at
+				busesChanged.set((i - kFirstModulationBusIndex) / 3);
+				continue;
+			}
+
+			// A bit field byte has one controller for all its bits, so sending the whole byte covers them all
+			auto const &param = *params.front();
+			if (useNRPN) {
+				int value = (param.bitposition() == -1 && param.bits() < 0) ? (int)(int8)next.at(i) : next.at(i);
+				auto nrpn = createParameterNRPN(param, value);
+				std::copy(nrpn.begin(), nrpn.end(), std::back_inserter(plan.messages));
+			}
+			else {
+				plan.messages.push_back(createRemoteParameterEdit(param.controller(), next.at(i)));
+			}
+		}
+
+		for (int bus = 0; bus < (int)busesChanged.size() && !plan.isFullDump; bus++) {
+			if (busesChanged.test(bus)) {
+				int index = kFirstModulationBusIndex + 3 * bus;
+				plan.messages.push_back(createModulationBusEdit(bus, next.at(index), next.at(index + 1), next.at(index + 2)));
+			}
+		}
+
+		for (auto const &message : plan.messages) {
+			plan.bytes += message.getRawDataSize();
+		}
+		if (plan.isFullDump || plan.bytes > kFullDumpSize) {
+			plan.isFullDump = true;
+			plan.messages = { createDataDump(MIDI_COMMAND.SINGLE_PATCH_TO_EDIT_BUFFER, 0x00, next.data()) };
+			plan.bytes = kFullDumpSize;
+		}
+		return plan;
+	}
+
+	MidiMessage Matrix1000::createDataDump(uint8 command, uint8 number, const PatchData &data) const
+	{
+		// Big enough for the master data, which is the longest block we ever send. Only bogus data sizes need to go to the heap
+		std::array<uint8, 4 + 2 * kMatrix1000MasterDataSize + 1> buffer;
+		if (data.size() > kMatrix1000MasterDataSize) {
+			std::vector<uint8> dump({ MIDI_ID.OBERHEIM, MIDI_ID.MATRIX6_1000, command, number });
+			auto escaped = escapeSysex(data);
+			std::copy(escaped.begin(), escaped.end(), std::back_inserter(dump));
+			return MidiHelpers::sysexMessage(dump);
+		}
+		buffer[0] = MIDI_ID.OBERHEIM;
+		buffer[1] = MIDI_ID.MATRIX6_1000;
+		buffer[2] = command;
+		buffer[3] = number;
+		int written = escapeSysex(data.data(), (int)data.size(), &buffer[4], (int)buffer.size() - 4);
+		jassert(written > 0);
+		return MidiMessage::createSysExMessage(buffer.data(), 4 + written);
+	}
+
 	void Matrix1000::initGlobalSettings()
 	{
 		// Loop over it and fill out the GlobalSettings Properties
 		globalSettings_.clear();
-		for (auto & matrix1000GlobalSetting : sMatrix1000GlobalSettings()->definitions) {
+		for (auto & matrix1000GlobalSetting : sMatrix1000GlobalSettings().definitions) {
 			auto setting = std::make_shared<TypedNamedValue>(matrix1000GlobalSetting.typedNamedValue);
 			globalSettings_.push_back(setting);
 		}
@@ -139,40 +335,149 @@ namespace midikraft {
 		globalSettingsTree_.addListener(&updateSynthWithGlobalSettingsListener_);
 	}
 
+	// Position of a global setting in the definitions table and therefore also in globalSettings_, looked up by its name
+	static int globalSettingIndex(std::string const &name) {
+		static std::map<std::string, int> index = []() {
+			std::map<std::string, int> result;
+			auto const &definitions = sMatrix1000GlobalSettings().definitions;
+			for (size_t i = 0; i < definitions.size(); i++) {
+				result[definitions[i].typedNamedValue.name().toStdString()] = (int)i;
+			}
+			return result;
+		}();
+		auto found = index.find(name);
+		return found != index.end() ? found->second : -1;
+	}
+
+	void Matrix1000::GlobalSettingsListener::setGlobalSettingsData(std::vector<uint8> const &data)
+	{
+		globalSettingsData_ = data;
+		byteSum_ = 0;
+		for (auto byte : data) {
+			byteSum_ += byte;
+		}
+		frame_ = { MIDI_ID.OBERHEIM, MIDI_ID.MATRIX6_1000, REQUEST_TYPE::MASTER, MIDI_ID.MATRIX1000_VERSION };
+		auto escaped = synth_->escapeSysex(data);
+		std::copy(escaped.begin(), escaped.end(), std::back_inserter(frame_));
+		dirty_.assign(sMatrix1000GlobalSettings().definitions.size(), false);
+		synth_->publishGlobalSettings(globalSettingsData_);
+	}
+
+	bool Matrix1000::GlobalSettingsListener::hasGlobalSettingsData() const
+	{
+		return !globalSettingsData_.empty();
+	}
+
+	bool Matrix1000::GlobalSettingsListener::pokeSetting(size_t index)
+	{
+		auto const &def = sMatrix1000GlobalSettings().definitions[index];
+		int newMidiValue = ((int)synth_->globalSettings_[index]->value().getValue()) - def.displayOffset;
+		if (def.isTwosComplement) {
+			if (newMidiValue < 0) {
+				newMidiValue = (uint8)newMidiValue;
+			}
+		}
+		uint8 newByte = (uint8)newMidiValue;
+		uint8 &byte = globalSettingsData_[def.sysexIndex];
+		if (byte == newByte) {
+			return false;
+		}
+		byteSum_ += newByte - byte;
+		byte = newByte;
+		updateFrame(def.sysexIndex);
+		return true;
+	}
+
+	void Matrix1000::GlobalSettingsListener::updateFrame(int sysexIndex)
+	{
+		// Same layout as escapeSysex: 4 bytes header, then low and high nibble of each byte, and the checksum last
+		uint8 byte = globalSettingsData_[sysexIndex];
+		frame_[4 + 2 * sysexIndex] = byte & 0x0f;
+		frame_[4 + 2 * sysexIndex + 1] = (byte & 0xf0) >> 4;
+		frame_[4 + 2 * globalSettingsData_.size()] = byteSum_ & 0x7f;
+	}
+
 	void Matrix1000::GlobalSettingsListener::valueTreePropertyChanged(ValueTree& treeWhosePropertyHasChanged, const Identifier& property)
 	{
-		// No matter which value changed, we need to create a new global settings sysex message and queue it for sending debounced
-		ignoreUnused(treeWhosePropertyHasChanged, property);
+		// Only the setting that changed is poked into the cached master data, then the escaped dump is queued for sending debounced
+		ignoreUnused(treeWhosePropertyHasChanged);
 
 		if (!globalSettingsData_.empty() && synth_->wasDetected()) {
-			auto newMessage = globalSettingsData_;
-			// Poke all values from the globalSettings array into the data
-			for (auto & setting : synth_->globalSettings_) {
-				//TODO Need to find definition for this setting now, suboptimal data structures
-				for (auto const &def : sMatrix1000GlobalSettings()->definitions) {
-					if (def.typedNamedValue.name() == setting->name()) {
-						int newMidiValue = ((int)setting->value().getValue()) - def.displayOffset;
-						if (def.isTwosComplement) {
-							if (newMidiValue < 0) {
-								newMidiValue = (uint8)newMidiValue;
-							}
-						}
-						newMessage[def.sysexIndex] = (uint8)newMidiValue;
-					}
+			int index = globalSettingIndex(property.toString().toStdString());
+			if (index >= 0) {
+				dirty_[index] = true;
+			}
+			else {
+				// Not one of ours by name, better check them all
+				dirty_.assign(dirty_.size(), true);
+			}
+
+			bool changed = false;
+			for (size_t i = 0; i < dirty_.size(); i++) {
+				if (dirty_[i]) {
+					changed = pokeSetting(i) || changed;
+					dirty_[i] = false;
+				}
+			}
+
+			// Setting the values from a dump received triggers this as well, but then there is nothing to send back
+			if (changed) {
+				synth_->publishGlobalSettings(globalSettingsData_);
+				auto globalSettingsDump = MidiMessage::createSysExMessage(frame_.data(), (int)frame_.size());
+				MidiController::instance()->getMidiOutput(synth_->midiOutput())->sendMessageDebounced(globalSettingsDump, 800);
+				MATRIX1000_COUNT(GLOBAL_SETTINGS_SENDS, 1);
+			}
+		}
+	}
+
+	Matrix1000::MessageClassification Matrix1000::classify(MidiMessage const &message)
+	{
+		MATRIX1000_COUNT(MESSAGES_CLASSIFIED, 1);
+		if (!message.isSysEx()) {
+			return { FOREIGN, 0 };
+		}
+		auto data = message.getSysExData();
+		int size = message.getSysExDataSize();
+
+		if (size >= 2 && data[0] == MIDI_ID.OBERHEIM && data[1] == MIDI_ID.MATRIX6_1000) {
+			if (size > 3) {
+				if (data[2] == MIDI_COMMAND.SINGLE_PATCH_DATA && data[3] < 100) {
+					// Should be a valid program number in this bank
+					return { PROGRAM_DUMP, data[3] };
+				}
+				if (data[2] == MIDI_COMMAND.SINGLE_PATCH_TO_EDIT_BUFFER && data[3] == 0x00) {
+					return { EDIT_BUFFER_WRITE, 0 };
+				}
+				if (data[2] == 0x03 /* Master Parameter Data */ && data[3] == MIDI_ID.MATRIX1000_VERSION) {
+					return { MASTER_DATA, 0 };
 				}
 			}
+			if (size > 2 && data[2] == 0x02) {
+				// Format: F0H 10H 06H 02H <number> <36 bytes of data> <checksum> F7H.
+				return { SPLIT_PATCH, 0 };
+			}
+			return { OTHER_OWN_SYSEX, 0 };
+		}
 
-			// Done, now create a new global sysex dump message
-			std::vector<uint8> globalSettingsData({ MIDI_ID.OBERHEIM, MIDI_ID.MATRIX6_1000, REQUEST_TYPE::MASTER, MIDI_ID.MATRIX1000_VERSION });
-			auto patchdata = synth_->escapeSysex(newMessage);
-			std::copy(patchdata.begin(), patchdata.end(), std::back_inserter(globalSettingsData));
-			MidiController::instance()->getMidiOutput(synth_->midiOutput())->sendMessageDebounced(MidiHelpers::sysexMessage(globalSettingsData), 800);
+		if (size == 13 &&
+			data[0] == 0x7e &&
+			data[2] == 0x06 &&
+			data[3] == 0x02 &&
+			data[4] == MIDI_ID.OBERHEIM &&
+			data[5] == MIDI_ID.MATRIX6_1000 &&
+			data[6] == 0x00 &&
+			//data[7] == 0x02 && // Fam member = Matrix 1000
+			data[8] == 0x00) {
+			// Characters 9 to 12 specify the firmware revision
+			return { DEVICE_ID_REPLY, data[1] }; // The channel reported by the Matrix
 		}
+		return { FOREIGN, 0 };
 	}
 
 	bool Matrix1000::isOwnSysex(MidiMessage const &message) const
 	{
-		return MidiHelpers::isSysexMessageMatching(message, { {0, MIDI_ID.OBERHEIM}, { 1, MIDI_ID.MATRIX6_1000 } });
+		auto type = classify(message).type;
+		return type != FOREIGN && type != DEVICE_ID_REPLY;
 	}
 
 	int Matrix1000::numberOfBanks() const
@@ -200,45 +505,68 @@ namespace midikraft {
 	{
 		// The Matrix1000 either sends Edit Buffers as Program Dumps, or it is a Single Patch Data to Edit Buffer message, which the M1k will never generate on its own, 
 		// but we will when we save data to disk.
-		return isSingleProgramDump(message) || 
-			(isOwnSysex(message) && MidiHelpers::isSysexMessageMatching(message, { {2, MIDI_COMMAND.SINGLE_PATCH_TO_EDIT_BUFFER}, { 3, (uint8)0x00} }));
+		auto type = classify(message).type;
+		return type == PROGRAM_DUMP || type == EDIT_BUFFER_WRITE;
 	}
 
 
 	bool Matrix1000::isSingleProgramDump(const MidiMessage& message) const
 	{
-		return isOwnSysex(message)
-			&& message.getSysExDataSize() > 3
-			&& message.getSysExData()[2] == MIDI_COMMAND.SINGLE_PATCH_DATA
-			&& message.getSysExData()[3] >= 0x00
-			&& message.getSysExData()[3] < 100; // Should be a valid program number in this bank
+		return classify(message).type == PROGRAM_DUMP;
 	}
 
 	MidiProgramNumber Matrix1000::getProgramNumber(const MidiMessage &message) const
 	{
-		if (isSingleProgramDump(message)) {
-			return MidiProgramNumber::fromZeroBase(message.getSysExData()[3]);
+		auto classification = classify(message);
+		if (classification.type == PROGRAM_DUMP) {
+			return MidiProgramNumber::fromZeroBase(classification.number);
 		}
 		return MidiProgramNumber::fromZeroBase(0);
 	}
 
 	std::shared_ptr<DataFile> Matrix1000::patchFromProgramDumpSysex(const MidiMessage& message) const
 	{
-		if (isSingleProgramDump(message)) {
-			//TODO doesn't check length of data provided
-			auto matrixPatch = std::make_shared<Matrix1000Patch>(unescapeSysex(&message.getSysExData()[4], message.getSysExDataSize() - 4), getProgramNumber(message));
-			return matrixPatch;
+		auto classification = classify(message);
+		if (classification.type == PROGRAM_DUMP) {
+			auto patch = decodePatch(message, MidiProgramNumber::fromZeroBase(classification.number));
+			if (!patch) {
+				reportBrokenDump(classification.number);
+			}
+			return patch;
 		}
 		return nullptr;
 	}
 
+	std::shared_ptr<DataFile> Matrix1000::decodePatch(const MidiMessage &message, MidiProgramNumber place) const
+	{
+		// Returns null for a checksum failure or a wrong length, it's up to the caller to report it together with the slot
+		std::array<uint8, kMatrix1000PatchDataSize> patchData;
+		if (message.getSysExDataSize() != kMatrix1000PatchDumpSize) {
+			return nullptr;
+		}
+		int decoded = unescapeSysex(&message.getSysExData()[4], kMatrix1000PatchDumpSize - 4, patchData.data(), (int)patchData.size());
+		if (decoded != kMatrix1000PatchDataSize) {
+			return nullptr;
+		}
+		return std::make_shared<Matrix1000Patch>(PatchData(patchData.begin(), patchData.end()), place);
+	}
+
+	bool Matrix1000::isIntactPatchDump(MidiMessage const &message)
+	{
+		std::array<uint8, kMatrix1000PatchDataSize> patchData;
+		return message.isSysEx() && message.getSysExDataSize() == kMatrix1000PatchDumpSize
+			&& unescapeSysex(&message.getSysExData()[4], kMatrix1000PatchDumpSize - 4, patchData.data(), (int)patchData.size()) == kMatrix1000PatchDataSize;
+	}
+
+	void Matrix1000::reportBrokenDump(int slot)
+	{
+		SimpleLogger::instance()->postMessage((boost::format("Matrix 1000: Program dump for program %02d has a wrong checksum or length, ignoring it") % slot).str());
+	}
+
 	std::vector<juce::MidiMessage> Matrix1000::patchToProgramDumpSysex(std::shared_ptr<DataFile> patch, MidiProgramNumber programNumber) const
 	{
 		uint8 programNo = programNumber.toZeroBased() % 100;
-		std::vector<uint8> singleProgramDump({ MIDI_ID.OBERHEIM, MIDI_ID.MATRIX6_1000, MIDI_COMMAND.SINGLE_PATCH_DATA, programNo });
-		auto patchdata = escapeSysex(patch->data());
-		std::copy(patchdata.begin(), patchdata.end(), std::back_inserter(singleProgramDump));
-		return std::vector<MidiMessage>({ MidiHelpers::sysexMessage(singleProgramDump) });
+		return { createDataDump(MIDI_COMMAND.SINGLE_PATCH_DATA, programNo, patch->data()) };
 	}
 
 	std::vector<MidiMessage> Matrix1000::requestStreamElement(int no, StreamType streamType) const
@@ -274,8 +602,10 @@ namespace midikraft {
 	bool Matrix1000::isMessagePartOfStream(const MidiMessage& message, StreamType streamType) const
 	{
 		switch (streamType) {
-		case StreamLoadCapability::StreamType::BANK_DUMP:
-			return isSingleProgramDump(message) || isSplitPatch(message) || globalSettingsLoader_->isDataFile(message, DataFileType(Matrix1000::PATCH));
+		case StreamLoadCapability::StreamType::BANK_DUMP: {
+			auto type = classify(message).type;
+			return type == PROGRAM_DUMP || type == SPLIT_PATCH || type == MASTER_DATA;
+		}
 		case StreamLoadCapability::StreamType::EDIT_BUFFER_DUMP:
 			return isEditBufferDump(message);
 		default:
@@ -285,44 +615,13 @@ namespace midikraft {
 
 	bool Matrix1000::isStreamComplete(std::vector<MidiMessage> const &messages, StreamType streamType) const
 	{
-		// Count the number of patch dumps in that stream
-		int found = 0;
-		int split = 0;
-		int master = 0;
-		int editbuffer = 0;
-		for (auto message : messages) {
-			switch (streamType) {
-			case midikraft::StreamLoadCapability::StreamType::BANK_DUMP:
-				if (isSingleProgramDump(message)) {
-					found++;
-				}
-				else if (isSplitPatch(message)) {
-					split++;
-				}
-				else if (globalSettingsLoader_->isDataFile(message, DataFileType(Matrix1000::DF_MATRIX1000_SETTINGS))) {
-					master++;
-				}
-				break;
-			case midikraft::StreamLoadCapability::StreamType::EDIT_BUFFER_DUMP:
-				if (isEditBufferDump(message)) {
-					editbuffer++;
-				}
-				break;
-			default:
-				break;
-			}
-		}
-		switch (streamType)
-		{
-		case midikraft::StreamLoadCapability::StreamType::EDIT_BUFFER_DUMP:			
-			return editbuffer > 0;
-		case midikraft::StreamLoadCapability::StreamType::BANK_DUMP:
-			// The documentation found in the Internet on the split patches is wrong. It states the Matrix 1000 sends 50, but in reality it sends 0x50 = 80. That is a strange number.
-			// Bob from Tauntek confirmed the assembler code of the M1K uses $50, so that error probably has been there since the 80s.
-			return found == numberOfPatches() && split == 0x50 && master > 0;
-		default:
-			return true;
+		// Only the messages added since the last call need to be classified
+		std::lock_guard<std::mutex> lock(streamTrackerLock_);
+		if (!streamTracker_ || streamTracker_->streamType() != streamType) {
+			streamTracker_ = std::make_unique<Matrix1000StreamTracker>(this, streamType);
 		}
+		streamTracker_->catchUp(messages);
+		return streamTracker_->isComplete();
 	}
 
 	bool Matrix1000::shouldStreamAdvance(std::vector<MidiMessage> const &messages, StreamType streamType) const
@@ -334,30 +633,97 @@ namespace midikraft {
 
 	midikraft::TPatchVector Matrix1000::loadPatchesFromStream(std::vector<MidiMessage> const &sysexMessages) const
 	{
-		TPatchVector result;
-		for (auto message : sysexMessages) {
-			if (isSingleProgramDump(message)) {
-				result.push_back(patchFromProgramDumpSysex(message));
-			}
-			else if (isEditBufferDump(message)) {
+		return loadPatchesFromStreamParallel(sysexMessages, 1);
+	}
+
+	midikraft::TPatchVector Matrix1000::loadPatchesFromStreamParallel(std::vector<MidiMessage> const &sysexMessages, int numThreads) const
+	{
+		// First pass only looks at the headers, which is cheap and keeps the log output in order
+		std::vector<std::pair<size_t, int>> patchMessages; // Index into sysexMessages and program number
+		patchMessages.reserve(sysexMessages.size());
+		for (size_t i = 0; i < sysexMessages.size(); i++) {
+			auto classification = classify(sysexMessages[i]);
+			switch (classification.type) {
+			case PROGRAM_DUMP:
+				patchMessages.emplace_back(i, classification.number);
+				break;
+			case EDIT_BUFFER_WRITE:
 				// This code will be reached for the message format "single patch data to edit buffer", which the M1k will never generate, but I will
-				result.push_back(patchFromSysex(message));
-			}
-			else if (isSplitPatch(message) || globalSettingsLoader_->isDataFile(message, DataFileType(Matrix1000::DF_MATRIX1000_SETTINGS))) {
+				patchMessages.emplace_back(i, 0);
+				break;
+			case SPLIT_PATCH:
+			case MASTER_DATA:
 				// Ignore other messages like global settings and fake split patches
+				break;
+			default:
+				SimpleLogger::instance()->postMessage("Matrix 1000: Ignoring sysex message found, not implemented: " + sysexMessages[i].getDescription());
+			}
+		}
+
+		// Second pass does the unescaping and creates the patches, each thread fills its own contiguous part of the result
+		TPatchVector result(patchMessages.size());
+		auto decodeRange = [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; i++) {
+				result[i] = decodePatch(sysexMessages[patchMessages[i].first], MidiProgramNumber::fromZeroBase(patchMessages[i].second));
+			}
+		};
+
+		const size_t kMinPatchesPerThread = 256; // Below that, starting a thread costs more than it saves
+		size_t threads = numThreads > 0 ? (size_t) numThreads : std::max(std::thread::hardware_concurrency(), 1u);
+		threads = std::min(threads, (patchMessages.size() + kMinPatchesPerThread - 1) / kMinPatchesPerThread);
+		if (threads <= 1) {
+			decodeRange(0, patchMessages.size());
+		}
+		else {
+			// Shared with the jobs, the last one to finish might still be signalling when we return
+			struct Chunks {
+				std::atomic<size_t> left;
+				WaitableEvent done;
+			};
+			auto chunks = std::make_shared<Chunks>();
+			size_t chunkSize = (patchMessages.size() + threads - 1) / threads;
+			chunks->left = (patchMessages.size() + chunkSize - 1) / chunkSize;
+			auto &pool = decodePool();
+			for (size_t from = 0; from < patchMessages.size(); from += chunkSize) {
+				size_t to = std::min(from + chunkSize, patchMessages.size());
+				pool.addJob([chunks, &decodeRange, from, to]() {
+					decodeRange(from, to);
+					if (--chunks->left == 0) {
+						chunks->done.signal();
+					}
+					return ThreadPoolJob::jobHasFinished;
+				});
+			}
+			chunks->done.wait();
+		}
+
+		// Broken dumps are reported in order with their slot and left out, use requestRecovery() to fetch them again
+		size_t kept = 0;
+		for (size_t i = 0; i < result.size(); i++) {
+			if (result[i]) {
+				result[kept++] = result[i];
 			}
 			else {
-				SimpleLogger::instance()->postMessage("Matrix 1000: Ignoring sysex message found, not implemented: " + message.getDescription());
+				reportBrokenDump(patchMessages[i].second);
 			}
 		}
+		result.resize(kept);
 		return result;
 	}
 
+	ThreadPool & Matrix1000::decodePool() const
+	{
+		std::lock_guard<std::mutex> lock(decodePoolLock_);
+		if (!decodePool_) {
+			decodePool_ = std::make_unique<ThreadPool>((int)std::max(std::thread::hardware_concurrency(), 1u));
+		}
+		return *decodePool_;
+	}
+
 	bool Matrix1000::isSplitPatch(MidiMessage const &message) const {
 		// The Matrix 1000 does not support split patches, but for the sake of compatibility with the Matrix 6 it will send out 50 split patches as answer to the request dump, 
 		// which shall be ignored...
-		// Format: F0H 10H 06H 02H <number> <36 bytes of data> <checksum> F7H.
-		return isOwnSysex(message) && message.getSysExDataSize() >2 && message.getSysExData()[2] == 0x02;
+		return classify(message).type == SPLIT_PATCH;
 	}
 
 	juce::MidiMessage Matrix1000::saveEditBufferToProgram(int programNumber)
@@ -380,17 +746,90 @@ namespace midikraft {
 		return result;
 	}
 
+	Matrix1000::PatchRequestBatch Matrix1000::requestPatches(std::vector<int> const &programNumbers) const
+	{
+		std::vector<int> sorted = programNumbers;
+		std::sort(sorted.begin(), sorted.end());
+		sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+		PatchRequestBatch result;
+		result.messages.reserve(sorted.size() + 2 * numberOfBanks());
+		result.expectedReplies.reserve(sorted.size());
+		int currentBank = -1;
+		for (int programNumber : sorted) {
+			if (programNumber < 0 || programNumber >= numberOfBanks() * numberOfPatches()) {
+				jassertfalse;
+				continue;
+			}
+			int bank = programNumber / 100;
+			if (bank != currentBank) {
+				result.messages.push_back(createBankSelect(MidiBankNumber::fromZeroBase(bank)));
+				result.messages.push_back(createBankUnlock());
+				currentBank = bank;
+			}
+			result.messages.push_back(createRequest(SINGLE_PATCH, (uint8)(programNumber % 100)));
+			result.expectedReplies.push_back(programNumber);
+		}
+		return result;
+	}
+
+	Matrix1000::PatchRequestBatch Matrix1000::requestRecovery(int bank, std::vector<MidiMessage> const &bankDump) const
+	{
+		// Only the programs that failed or never arrived are requested again, as single patches instead of another bank dump
+		Matrix1000StreamTracker tracker(this, StreamType::BANK_DUMP);
+		tracker.catchUp(bankDump);
+		std::vector<int> programNumbers;
+		for (int slot : tracker.programsToRecover()) {
+			programNumbers.push_back(bank * numberOfPatches() + slot);
+		}
+		return requestPatches(programNumbers);
+	}
+
+	Matrix1000::PatchRequestBatch::ReplyCursor::ReplyCursor(PatchRequestBatch const &batch) : expected_(batch.expectedReplies), next_(0)
+	{
+	}
+
+	int Matrix1000::PatchRequestBatch::ReplyCursor::programNumberOfReply(MidiMessage const &reply)
+	{
+		auto classification = classify(reply);
+		if (classification.type != PROGRAM_DUMP) {
+			return -1;
+		}
+		for (size_t i = next_; i < expected_.size(); i++) {
+			if (expected_[i] % 100 == classification.number) {
+				// The replies in between didn't make it
+				lost_.insert(lost_.end(), expected_.begin() + next_, expected_.begin() + i);
+				next_ = i + 1;
+				return expected_[i];
+			}
+		}
+		return -1;
+	}
+
+	bool Matrix1000::PatchRequestBatch::ReplyCursor::isDone() const
+	{
+		return next_ >= expected_.size();
+	}
+
+	std::vector<int> const & Matrix1000::PatchRequestBatch::ReplyCursor::lostReplies() const
+	{
+		return lost_;
+	}
+
 	std::shared_ptr<DataFile> Matrix1000::patchFromSysex(const MidiMessage& message) const
 	{
-		if (!isEditBufferDump(message)) {
+		auto classification = classify(message);
+		if (classification.type != PROGRAM_DUMP && classification.type != EDIT_BUFFER_WRITE) {
 			jassert(false);
 			return std::make_shared<Matrix1000Patch>(PatchData(), MidiProgramNumber());
 		}
 
 		// Decode the data
-		const uint8 *startOfData = &message.getSysExData()[4];
-		auto matrixPatch = std::make_shared<Matrix1000Patch>(unescapeSysex(startOfData, message.getSysExDataSize() - 4), getProgramNumber(message));
-		return matrixPatch;
+		auto patch = decodePatch(message, MidiProgramNumber::fromZeroBase(classification.number));
+		if (!patch) {
+			reportBrokenDump(classification.number);
+		}
+		return patch;
 	}
 
 	std::shared_ptr<DataFile> Matrix1000::patchFromPatchData(const Synth::PatchData &data, MidiProgramNumber place) const {
@@ -406,6 +845,46 @@ namespace midikraft {
 		return Patch::blankOut(kMatrix1000BlankOutZones, unfilteredData->data());
 	}
 
+	uint64 Matrix1000::voiceFingerprint(const uint8 *patchData, size_t size)
+	{
+		// Word at a time multiply and rotate hash, seeded with the size. Good enough to bucket patches, equality is always confirmed on the bytes
+		const uint64 kMultiplier = 0x9e3779b97f4a7c15ULL;
+		uint64 hash = kMultiplier ^ size;
+		forEachVoiceRelevantRange(size, [&](size_t start, size_t end) {
+			size_t i = start;
+			for (; i + 8 <= end; i += 8) {
+				uint64 word;
+				memcpy(&word, patchData + i, sizeof(word));
+				hash = (hash ^ word) * kMultiplier;
+				hash ^= hash >> 29;
+			}
+			for (; i < end; i++) {
+				hash = (hash ^ patchData[i]) * kMultiplier;
+				hash ^= hash >> 29;
+			}
+		});
+		return hash;
+	}
+
+	uint64 Matrix1000::voiceFingerprint(std::shared_ptr<DataFile> patch) const
+	{
+		return voiceFingerprint(patch->data().data(), patch->data().size());
+	}
+
+	std::vector<std::vector<size_t>> Matrix1000::findDuplicates(TPatchVector const &patches) const
+	{
+		return findDuplicatesOf(patches.size(), [&](size_t index) {
+			return std::make_pair(patches[index]->data().data(), patches[index]->data().size());
+		});
+	}
+
+	std::vector<std::vector<size_t>> Matrix1000::findDuplicates(Matrix1000Library const &library) const
+	{
+		return findDuplicatesOf(library.size(), [&](size_t index) {
+			return std::make_pair(library.patchData(index), (size_t)kMatrix1000PatchDataSize);
+		});
+	}
+
 	bool Matrix1000::canChangeInputChannel() const
 	{
 		//TODO - actually you can do that, but it requires a complete roundtrip to query the global page, change the channel, and send the changed page back.
@@ -453,31 +932,59 @@ namespace midikraft {
 
 	int Matrix1000::deviceDetectSleepMS()
 	{
-		// The Matrix1000 can be sluggish to react on a Device ID request, better wait for 200 ms
-		return 200;
+		// The Matrix1000 can be sluggish to react on a Device ID request, better wait for 200 ms unless we have measured the port
+		return Matrix1000Detector::learnedLatencyMS(midiOutput(), 200);
 	}
 
 	MidiChannel Matrix1000::channelIfValidDeviceResponse(const MidiMessage &message)
 	{
-		auto data = message.getSysExData();
-		if (message.getSysExDataSize() < 3)
-			return MidiChannel::invalidChannel();
-
-		if (message.getSysExDataSize() == 13 &&
-			data[0] == 0x7e &&
-			data[2] == 0x06 &&
-			data[3] == 0x02 &&
-			data[4] == MIDI_ID.OBERHEIM &&
-			data[5] == MIDI_ID.MATRIX6_1000 &&
-			data[6] == 0x00 &&
-			//data[7] == 0x02 && // Fam member = Matrix 1000
-			data[8] == 0x00) {
-			return MidiChannel::fromZeroBase(data[1]); // Return the channel reported by the Matrix
+		auto classification = classify(message);
+		if (classification.type == DEVICE_ID_REPLY) {
+			std::lock_guard<std::mutex> lock(firmwareLock_);
+			firmwareByChannel_[classification.number] = parseFirmware(message);
+			return MidiChannel::fromZeroBase(classification.number); // Return the channel reported by the Matrix
 		}
-		// Characters 9 to 12 specify the firmware revision
 		return MidiChannel::invalidChannel();
 	}
 
+	Matrix1000::FirmwareInfo Matrix1000::parseFirmware(MidiMessage const &deviceIdReply)
+	{
+		FirmwareInfo result = { 0 };
+		if (classify(deviceIdReply).type != DEVICE_ID_REPLY) {
+			return result;
+		}
+		// Characters 9 to 12 are the firmware revision. Take the digits in there, so "1.20", "120 " and "0120" all give 120.
+		// Should a unit send plain numbers instead, read them as major and minor version
+		auto revision = &deviceIdReply.getSysExData()[9];
+		bool isText = std::all_of(revision, revision + 4, [](uint8 c) { return c >= 0x20; });
+		if (isText) {
+			for (int i = 0; i < 4; i++) {
+				if (revision[i] >= '0' && revision[i] <= '9') {
+					result.version = result.version * 10 + (revision[i] - '0');
+				}
+			}
+		}
+		else {
+			result.version = revision[0] * 100 + revision[1];
+		}
+		return result;
+	}
+
+	Matrix1000::FirmwareInfo Matrix1000::firmware() const
+	{
+		return firmware(channel());
+	}
+
+	Matrix1000::FirmwareInfo Matrix1000::firmware(MidiChannel channel) const
+	{
+		std::lock_guard<std::mutex> lock(firmwareLock_);
+		auto found = channel.isValid() ? firmwareByChannel_.find(channel.toZeroBasedInt()) : firmwareByChannel_.end();
+		if (found != firmwareByChannel_.end()) {
+			return found->second;
+		}
+		return { 0 };
+	}
+
 	bool Matrix1000::needsChannelSpecificDetection()
 	{
 		return true;
@@ -487,19 +994,9 @@ namespace midikraft {
 	{
 		auto settingsArray = unescapeSysex(dataFile->data().data(), (int)dataFile->data().size());
 		if (settingsArray.size() == 172) {
-			updateSynthWithGlobalSettingsListener_.globalSettingsData_ = settingsArray;
-			for (size_t i = 0; i < sMatrix1000GlobalSettings()->definitions.size(); i++) {
-				if (i < settingsArray.size()) {
-					int intValue = settingsArray[sMatrix1000GlobalSettings()->definitions[i].sysexIndex] + sMatrix1000GlobalSettings()->definitions[i].displayOffset;
-					if (sMatrix1000GlobalSettings()->definitions[i].isTwosComplement) {
-						// Very special code that only works because there are just two fields in the global settings that need it
-						// Master transpose and Master tuning
-						if (intValue > 127) {
-							intValue = (int8)intValue;
-						}
-					}
-					globalSettings_[i]->value().setValue(var(intValue));
-				}
+			updateSynthWithGlobalSettingsListener_.setGlobalSettingsData(settingsArray);
+			for (size_t i = 0; i < sMatrix1000GlobalSettings().definitions.size(); i++) {
+				globalSettings_[i]->value().setValue(var(globalSettingValue(sMatrix1000GlobalSettings().definitions[i], settingsArray)));
 			}
 		}
 		else {
@@ -508,6 +1005,21 @@ namespace midikraft {
 		}
 	}
 
+	void Matrix1000::publishGlobalSettings(std::vector<uint8> const &masterData)
+	{
+		auto snapshot = std::make_shared<GlobalSettingsSnapshot>();
+		snapshot->masterData = masterData;
+		for (auto const &def : sMatrix1000GlobalSettings().definitions) {
+			snapshot->values.push_back(globalSettingValue(def, masterData));
+		}
+		std::atomic_store(&globalSettingsSnapshot_, std::shared_ptr<const GlobalSettingsSnapshot>(snapshot));
+	}
+
+	std::shared_ptr<const Matrix1000::GlobalSettingsSnapshot> Matrix1000::globalSettingsSnapshot() const
+	{
+		return std::atomic_load(&globalSettingsSnapshot_);
+	}
+
 	std::vector<std::shared_ptr<TypedNamedValue>> Matrix1000::getGlobalSettings()
 	{
 		return globalSettings_;
@@ -530,10 +1042,7 @@ namespace midikraft {
 
 	std::vector<juce::MidiMessage> Matrix1000::patchToSysex(std::shared_ptr<DataFile> patch) const
 	{
-		std::vector<uint8> editBufferDump({ MIDI_ID.OBERHEIM, MIDI_ID.MATRIX6_1000, MIDI_COMMAND.SINGLE_PATCH_TO_EDIT_BUFFER, 0x00 /* Unspecified, but let's assume 0 is ok */ });
-		auto patchdata = escapeSysex(patch->data());
-		std::copy(patchdata.begin(), patchdata.end(), std::back_inserter(editBufferDump));
-		return std::vector<MidiMessage>({ MidiHelpers::sysexMessage(editBufferDump) });
+		return { createDataDump(MIDI_COMMAND.SINGLE_PATCH_TO_EDIT_BUFFER, 0x00 /* Unspecified, but let's assume 0 is ok */, patch->data()) };
 	}
 
 	Matrix1000::Matrix1000() : updateSynthWithGlobalSettingsListener_(this)
@@ -553,42 +1062,115 @@ namespace midikraft {
 
 	Synth::PatchData Matrix1000::unescapeSysex(const uint8 *sysExData, int sysExLen) const
 	{
-		Synth::PatchData result;
+		Synth::PatchData result(std::max(sysExLen, 0) / 2);
+		int decoded = unescapeSysex(sysExData, sysExLen, result.data(), (int)result.size());
+		if (decoded < 0) {
+			// Invalid checksum, don't use this
+			result.clear();
+		}
+		return result;
+	}
+
+	std::vector<juce::uint8> Matrix1000::escapeSysex(const PatchData &programEditBuffer) const
+	{
+		std::vector<uint8> result(programEditBuffer.size() * 2 + 1);
+		escapeSysex(programEditBuffer.data(), (int)programEditBuffer.size(), result.data(), (int)result.size());
+		return result;
+	}
+
+#if JUCE_LITTLE_ENDIAN
+	// Pack the nibble pairs held in the four 16 bit lanes of a little endian word into four bytes
+	static uint64 packNibbleLanes(uint64 word) {
+		word = (word & 0x00ff00ff00ff00ffULL) | ((word >> 4) & 0x00f000f000f000f0ULL);
+		word = (word | (word >> 8)) & 0x0000ffff0000ffffULL;
+		return (word | (word >> 16)) & 0x00000000ffffffffULL;
+	}
+
+	// The reverse, spread four bytes into four 16 bit lanes with the low nibble first
+	static uint64 spreadNibbleLanes(uint64 word) {
+		word = (word | (word << 16)) & 0x0000ffff0000ffffULL;
+		word = (word | (word << 8)) & 0x00ff00ff00ff00ffULL;
+		return (word & 0x000f000f000f000fULL) | ((word << 4) & 0x0f000f000f000f00ULL);
+	}
+
+	// Sum of the eight bytes of a word. 16 bit lanes can't overflow, so the multiplication collects the total in the top lane
+	static uint8 sumOfBytes(uint64 word) {
+		word = (word & 0x00ff00ff00ff00ffULL) + ((word >> 8) & 0x00ff00ff00ff00ffULL);
+		return (uint8)((word * 0x0001000100010001ULL) >> 48);
+	}
+#endif
 
+	int Matrix1000::unescapeSysex(const uint8 *sysExData, int sysExLen, uint8 *outData, int outSize)
+	{
 		// The Matrix 1000 does two things: Calculate a checksum (yes, it's a sum) and pack each byte into two nibbles. That's not really
 		// data efficient, but hey, a 2 MHz 8-bit CPU must be able to pack and unpack that at MIDI speed!
+		// An odd length means the last byte is the checksum, an even length is taken as data without checksum
+		MATRIX1000_TIME_SCOPE(UNESCAPE_TIME);
+		if (sysExLen < 0) {
+			return -1;
+		}
+		MATRIX1000_COUNT(BYTES_UNESCAPED, sysExLen);
+		int numBytes = sysExLen / 2;
+		if (numBytes > outSize) {
+			return -1;
+		}
+
 		uint8 checksum = 0;
-		for (int index = 0; index < sysExLen; ) {
-			// Read one more data byte from two bytes
-			uint8 byte = sysExData[index] | sysExData[index + 1] << 4;
-			result.push_back(byte);
+		int i = 0;
+#if JUCE_LITTLE_ENDIAN
+		// Eight data bytes per round, from two words of sixteen nibbles
+		for (; i + 8 <= numBytes; i += 8) {
+			uint64 low, high;
+			memcpy(&low, sysExData + 2 * i, sizeof(low));
+			memcpy(&high, sysExData + 2 * i + 8, sizeof(high));
+			uint64 packed = packNibbleLanes(low) | (packNibbleLanes(high) << 32);
+			memcpy(outData + i, &packed, sizeof(packed));
+			checksum += sumOfBytes(packed);
+		}
+#endif
+		for (; i < numBytes; i++) {
+			uint8 byte = (uint8)(sysExData[2 * i] | sysExData[2 * i + 1] << 4);
+			outData[i] = byte;
 			checksum += byte;
-			index += 2;
-			if (index == sysExLen - 1) {
-				// This is the checksum!
-				if (sysExData[index] != (checksum & 0x7f)) {
-					// Invalid checksum, don't use this
-					result.clear();
-					return result;
-				}
-				index++;
-			}
 		}
-		return result;
+
+		if ((sysExLen & 1) && sysExData[sysExLen - 1] != (checksum & 0x7f)) {
+			// Invalid checksum, don't use this
+			MATRIX1000_COUNT(CHECKSUM_FAILURES, 1);
+			return -1;
+		}
+		return numBytes;
 	}
 
-	std::vector<juce::uint8> Matrix1000::escapeSysex(const PatchData &programEditBuffer) const
+	int Matrix1000::escapeSysex(const uint8 *data, int dataLen, uint8 *outSysex, int outSize)
 	{
-		std::vector<uint8> result;
 		// We generate the nibbles and the checksum
-		int checksum = 0;
-		for (int i = 0; i < programEditBuffer.size(); i++) {
-			checksum += programEditBuffer[i];
-			result.push_back(programEditBuffer[i] & 0x0f);
-			result.push_back((programEditBuffer[i] & 0xf0) >> 4);
+		MATRIX1000_TIME_SCOPE(ESCAPE_TIME);
+		if (dataLen < 0 || outSize < 2 * dataLen + 1) {
+			return -1;
 		}
-		result.push_back(checksum & 0x7f);
-		return result;
+		MATRIX1000_COUNT(BYTES_ESCAPED, dataLen);
+
+		uint8 checksum = 0;
+		int i = 0;
+#if JUCE_LITTLE_ENDIAN
+		for (; i + 8 <= dataLen; i += 8) {
+			uint64 word;
+			memcpy(&word, data + i, sizeof(word));
+			uint64 low = spreadNibbleLanes(word & 0xffffffffULL);
+			uint64 high = spreadNibbleLanes(word >> 32);
+			memcpy(outSysex + 2 * i, &low, sizeof(low));
+			memcpy(outSysex + 2 * i + 8, &high, sizeof(high));
+			checksum += sumOfBytes(word);
+		}
+#endif
+		for (; i < dataLen; i++) {
+			checksum += data[i];
+			outSysex[2 * i] = data[i] & 0x0f;
+			outSysex[2 * i + 1] = (data[i] & 0xf0) >> 4;
+		}
+		outSysex[2 * dataLen] = checksum & 0x7f;
+		return 2 * dataLen + 1;
 	}
 
 	/*void Matrix1000::setupBCR2000(MidiController *controller, BCR2000 &bcr, SimpleLogger *logger) {
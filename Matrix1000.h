@@ -19,9 +19,17 @@
 
 #include "MidiController.h"
 
+#include "Matrix1000ParamDefinition.h"
+
+#include <map>
+#include <mutex>
+
 namespace midikraft {
 
 	class Matrix1000_GlobalSettings_Loader;
+	class Matrix1000StreamTracker;
+	class Matrix1000Library;
+	class Matrix1000Patch;
 
 	class Matrix1000 : public Synth, /* public SupportedByBCR2000, */
 		public SimpleDiscoverableDevice,
@@ -95,12 +103,120 @@ namespace midikraft {
 		// Matrix1000 specific functions
 		bool isSplitPatch(MidiMessage const &message) const;
 
+		// Immutable copy of the master data as last received or edited, for reading the global settings from any thread without locking.
+		// Null until master data has been received
+		struct GlobalSettingsSnapshot {
+			std::vector<uint8> masterData; // Unescaped, 172 bytes
+			std::vector<int> values; // In the order of getGlobalSettings()
+		};
+		std::shared_ptr<const GlobalSettingsSnapshot> globalSettingsSnapshot() const;
+
+		// Messages to change a single value of the edit buffer. Signed values are sent as 7 bit two's complement
+		MidiMessage createRemoteParameterEdit(int controller, int value) const;
+		MidiMessage createModulationBusEdit(int bus, int source, int amount, int destination) const;
+		std::vector<MidiMessage> createParameterNRPN(Matrix1000ParamDefinition const &param, int value) const; // Needs firmware 1.16 or 1.20
+
+		// Messages to turn the edit buffer holding current into next. Uses single value messages for the bytes that differ,
+		// or a full edit buffer dump if that is shorter on the wire. The name is ignored, as the edit buffer name is never displayed
+		struct EditPlan {
+			bool isFullDump;
+			std::vector<MidiMessage> messages;
+			std::vector<Matrix1000Param> changedParameters;
+			int bytes;
+		};
+		EditPlan createEditPlan(Matrix1000Patch const &current, Matrix1000Patch const &next, bool useNRPN = false) const;
+
+		// What the firmware of a unit can do beyond the original one, from the revision in its device ID reply
+		struct FirmwareInfo {
+			int version; // 110 for 1.10 and so on, 0 if not known
+			bool isKnown() const { return version > 0; }
+			bool supportsNRPN() const { return version >= 116; }
+			bool supportsUnisonDetune() const { return version >= 116; } // Controller 0x5e
+		};
+		static FirmwareInfo parseFirmware(MidiMessage const &deviceIdReply);
+
+		// Remembered for each channel a unit answered on during device detection
+		FirmwareInfo firmware() const; // Of the unit on channel()
+		FirmwareInfo firmware(MidiChannel channel) const;
+
+		enum MessageType {
+			FOREIGN,
+			PROGRAM_DUMP,
+			EDIT_BUFFER_WRITE, // Single Patch Data to Edit Buffer, which the M1k never sends but we write into files
+			SPLIT_PATCH,
+			MASTER_DATA,
+			DEVICE_ID_REPLY,
+			OTHER_OWN_SYSEX // Any other Oberheim Matrix 6/1000 sysex, e.g. requests
+		};
+		struct MessageClassification {
+			MessageType type;
+			int number; // Program number within the bank for PROGRAM_DUMP, zero based MIDI channel for DEVICE_ID_REPLY, else 0
+		};
+
+		// Reads the header once and tells what kind of message this is. All the is... predicates are built on this
+		static MessageClassification classify(MidiMessage const &message);
+
+		// Batch version of loadPatchesFromStream() for large libraries. The messages are classified first, and then decoded
+		// in up to numThreads chunks (0 means one per core) on a thread pool kept for the next call. The result is in the same order as the input
+		TPatchVector loadPatchesFromStreamParallel(std::vector<MidiMessage> const &sysexMessages, int numThreads = 0) const;
+
+		// Requests for many programs, sorted by bank so each bank is selected and unlocked only once. The replies come back as
+		// program dumps in the order of expectedReplies, which holds the full program numbers (0 to 999)
+		struct PatchRequestBatch {
+			std::vector<MidiMessage> messages;
+			std::vector<int> expectedReplies;
+
+			// Tells the full program number of the replies as they come in. A program dump carries only the slot within the bank, so it is
+			// matched to the next expected entry with that slot. The entries skipped on the way are taken as lost replies, so one lost reply
+			// doesn't throw off the ones after it. The same slot requested in two banks is told apart by order, the first dump of slot 5
+			// is program 5, the next one 105. Only if the reply of 5 gets lost, the dump of 105 is taken for 5, as nothing in it tells the bank.
+			class ReplyCursor {
+			public:
+				explicit ReplyCursor(PatchRequestBatch const &batch);
+
+				// Full program number, or -1 if this is not a program dump or its slot is not expected anymore, e.g. a duplicate
+				int programNumberOfReply(MidiMessage const &reply);
+				bool isDone() const; // All expected replies arrived or were skipped as lost
+				std::vector<int> const &lostReplies() const; // Program numbers skipped, in request order
+
+			private:
+				std::vector<int> expected_; // A copy, so the cursor may outlive the batch it was made from
+				size_t next_;
+				std::vector<int> lost_;
+			};
+		};
+		PatchRequestBatch requestPatches(std::vector<int> const &programNumbers) const;
+
+		// Single patch requests for the programs of a bank dump that arrived with a wrong checksum or length, or not at all.
+		// Much shorter than requesting the whole bank again after a glitch
+		PatchRequestBatch requestRecovery(int bank, std::vector<MidiMessage> const &bankDump) const;
+
+		// True if the program dump or single patch to edit buffer message has the right length and checksum
+		static bool isIntactPatchDump(MidiMessage const &message);
+
+		// 64 bit hash of the voice relevant bytes, i.e. of what filterVoiceRelevantData() keeps, computed in place without copying
+		static uint64 voiceFingerprint(const uint8 *patchData, size_t size);
+		uint64 voiceFingerprint(std::shared_ptr<DataFile> patch) const;
+
+		// Groups of indexes of patches with identical voice data, in linear time. Only groups with at least two members are returned,
+		// the indexes in each group are in input order
+		std::vector<std::vector<size_t>> findDuplicates(TPatchVector const &patches) const;
+		std::vector<std::vector<size_t>> findDuplicates(Matrix1000Library const &library) const;
+
 		//private: Only for testing public
 		PatchData unescapeSysex(const uint8 *sysExData, int sysExLen) const;
 		std::vector<uint8> escapeSysex(const PatchData &programEditBuffer) const;
 
+		// Allocation free variants of the nibble codec, writing into a caller provided buffer.
+		// Both return the number of bytes written, or -1 if the buffer is too small or the checksum does not match
+		static int unescapeSysex(const uint8 *sysExData, int sysExLen, uint8 *outData, int outSize);
+		static int escapeSysex(const uint8 *data, int dataLen, uint8 *outSysex, int outSize);
+
 	private:
 		friend class Matrix1000_GlobalSettings_Loader;
+		friend class Matrix1000BackupEngine;
+		friend class Matrix1000BankRestore;
+		friend class Matrix1000Transfer;
 
 		enum Matrix1000_DataFileType {
 			PATCH = 0,
@@ -116,6 +232,10 @@ namespace midikraft {
 		MidiMessage createRequest(REQUEST_TYPE typeNo, uint8 number) const;
 		MidiMessage createBankSelect(MidiBankNumber bankNo) const;
 		MidiMessage createBankUnlock() const;
+		MidiMessage createDataDump(uint8 command, uint8 number, const PatchData &data) const;
+		std::shared_ptr<DataFile> decodePatch(const MidiMessage &message, MidiProgramNumber place) const; // Null if the message is broken
+		static void reportBrokenDump(int slot);
+		ThreadPool &decodePool() const;
 
 		MidiController::HandlerHandle matrixBCRSyncHandler_ = MidiController::makeNoneHandle();
 
@@ -125,19 +245,39 @@ namespace midikraft {
 			GlobalSettingsListener(Matrix1000 *synth) : synth_(synth) {}
 			void valueTreePropertyChanged(ValueTree& treeWhosePropertyHasChanged, const Identifier& property) override;
 
-			std::vector<uint8> globalSettingsData_; // The global settings data as last retrieved from the synth
+			void setGlobalSettingsData(std::vector<uint8> const &data);
+			bool hasGlobalSettingsData() const;
 
 		private:
+			bool pokeSetting(size_t index); // Returns true if the byte in the data changed
+			void updateFrame(int sysexIndex);
+
 			Matrix1000 *synth_;
+			std::vector<uint8> globalSettingsData_; // The global settings data as last retrieved from the synth, with the edits applied
+			std::vector<uint8> frame_; // The escaped master data sysex (without F0/F7) matching globalSettingsData_
+			int byteSum_ = 0; // Sum of all bytes of globalSettingsData_, the sysex checksum are the lower 7 bits of it
+			std::vector<bool> dirty_;
 		};
 
 		void initGlobalSettings();
+		void publishGlobalSettings(std::vector<uint8> const &masterData);
 
 		std::shared_ptr<Matrix1000_GlobalSettings_Loader> globalSettingsLoader_; // Sort of a pimpl pattern
 		TypedNamedValueSet globalSettings_;
 		ValueTree globalSettingsTree_;
 		GlobalSettingsListener updateSynthWithGlobalSettingsListener_;
-		
+		std::shared_ptr<const GlobalSettingsSnapshot> globalSettingsSnapshot_; // Only accessed with std::atomic_load and std::atomic_store
+
+		mutable std::mutex firmwareLock_;
+		std::map<int, FirmwareInfo> firmwareByChannel_;
+
+		// isStreamComplete() is called with the growing message vector, so we remember what we have classified already
+		mutable std::mutex streamTrackerLock_;
+		mutable std::unique_ptr<Matrix1000StreamTracker> streamTracker_;
+
+		// Created on the first parallel load, one thread per core
+		mutable std::mutex decodePoolLock_;
+		mutable std::unique_ptr<ThreadPool> decodePool_;
 	};
 
 }
@@ -226,7 +226,7 @@ std::string Matrix1000BCR::generateMapping(std::string const &presetName, std::m
 			auto m1000bcr = dynamic_cast<Matrix1000BCRDefinition *>(def);
 			if (m1000bcr) {
 				// Need to find the appropriate param definition
-				for (auto param : Matrix1000ParamDefinition::allDefinitions) {
+				for (auto param : Matrix1000ParamDefinition::allDefinitions()) {
 					auto m1000param = dynamic_cast<Matrix1000ParamDefinition *>(param);
 					if (m1000param) {
 						if (m1000param->id() == paramIndex) {
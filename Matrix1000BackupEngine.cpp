@@ -0,0 +1,340 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000BackupEngine.h"
+
+#include "Matrix1000_GlobalSettings.h"
+
+#include <boost/format.hpp>
+
+namespace midikraft {
+
+	// Number of single patch requests in flight, so the Matrix has the next request waiting when it finished sending a program
+	const size_t kSinglePatchRequestWindow = 2;
+
+	// How often a program may arrive broken until we give up on it
+	const int kMaximumRecoveryAttempts = 3;
+
+	Matrix1000BackupEngine::Matrix1000BackupEngine(Matrix1000 *matrix1000, TSendFunction send) :
+		matrix1000_(matrix1000), send_(send), mode_(Mode::BANK_DUMPS), includeMasterData_(false), recoveryEnabled_(true), recovering_(false), awaitingDumpEnd_(false), receivingBank_(0), nextRequest_(0), lastActivity_(0), finished_(true)
+	{
+	}
+
+	void Matrix1000BackupEngine::setProgressHandler(TProgressHandler handler)
+	{
+		onProgress_ = handler;
+	}
+
+	void Matrix1000BackupEngine::setFinishedHandler(TFinishedHandler handler)
+	{
+		onFinished_ = handler;
+	}
+
+	void Matrix1000BackupEngine::setRecoveryEnabled(bool enabled)
+	{
+		recoveryEnabled_ = enabled;
+	}
+
+	void Matrix1000BackupEngine::start(std::vector<int> const &programNumbers, Mode mode, bool includeMasterData)
+	{
+		mode_ = mode;
+		includeMasterData_ = includeMasterData;
+		banks_.clear();
+		bankState_.clear();
+		patches_.clear();
+		masterData_.reset();
+		failures_.clear();
+		recovering_ = false;
+		awaitingDumpEnd_ = false;
+		outstandingRequests_.clear();
+		nextRequest_ = 0;
+		receivingBank_ = 0;
+		finished_ = false;
+
+		for (int programNumber : programNumbers) {
+			if (programNumber < 0 || programNumber >= matrix1000_->numberOfBanks() * matrix1000_->numberOfPatches()) {
+				jassertfalse;
+				continue;
+			}
+			bankState_[programNumber / 100].wanted.set(programNumber % 100);
+		}
+		for (auto const &bank : bankState_) {
+			banks_.push_back(bank.first);
+		}
+
+		lastActivity_ = Time::getMillisecondCounter();
+		if (banks_.empty()) {
+			checkFinished();
+		}
+		else {
+			requestBank(0);
+		}
+	}
+
+	void Matrix1000BackupEngine::startFullBackup(Mode mode, bool includeMasterData)
+	{
+		std::vector<int> all;
+		for (int i = 0; i < matrix1000_->numberOfBanks() * matrix1000_->numberOfPatches(); i++) {
+			all.push_back(i);
+		}
+		start(all, mode, includeMasterData);
+	}
+
+	bool Matrix1000BackupEngine::usesSinglePatchRequests() const
+	{
+		return mode_ == Mode::SINGLE_PATCHES || recovering_;
+	}
+
+	void Matrix1000BackupEngine::requestBank(size_t bankIndex)
+	{
+		int bank = banks_[bankIndex];
+		recovering_ = false;
+		switch (mode_) {
+		case Mode::BANK_DUMPS:
+			awaitingDumpEnd_ = true;
+			send_({ matrix1000_->createBankSelect(MidiBankNumber::fromZeroBase(bank)), matrix1000_->createRequest(Matrix1000::BANK_AND_MASTER, 0) });
+			break;
+		case Mode::SINGLE_PATCHES:
+			send_({ matrix1000_->createBankSelect(MidiBankNumber::fromZeroBase(bank)), matrix1000_->createBankUnlock() });
+			outstandingRequests_.clear();
+			nextRequest_ = 0;
+			requestNextSinglePatches();
+			break;
+		}
+	}
+
+	void Matrix1000BackupEngine::requestNextSinglePatches()
+	{
+		auto &state = bankState_[banks_[receivingBank_]];
+		std::vector<MidiMessage> requests;
+		while (outstandingRequests_.size() < kSinglePatchRequestWindow && nextRequest_ < matrix1000_->numberOfPatches()) {
+			int slot = nextRequest_++;
+			bool outstanding = std::find(outstandingRequests_.begin(), outstandingRequests_.end(), slot) != outstandingRequests_.end();
+			if (state.wanted.test(slot) && !state.received.test(slot) && !state.givenUp.test(slot) && !outstanding) {
+				outstandingRequests_.push_back(slot);
+				requests.push_back(matrix1000_->createRequest(Matrix1000::SINGLE_PATCH, (uint8)slot));
+			}
+		}
+		if (!requests.empty()) {
+			send_(requests);
+		}
+	}
+
+	void Matrix1000BackupEngine::handleMessage(MidiMessage const &message)
+	{
+		if (finished_) {
+			return;
+		}
+
+		auto classification = Matrix1000::classify(message);
+		switch (classification.type) {
+		case Matrix1000::PROGRAM_DUMP: {
+			lastActivity_ = Time::getMillisecondCounter();
+			int bank = banks_[receivingBank_];
+			auto &state = bankState_[bank];
+			int slot = classification.number;
+			state.arrived.set(slot);
+			if (state.wanted.test(slot) && !state.received.test(slot)) {
+				// The program dump only knows the slot within the bank, so we put in the full program number ourselves
+				int programNumber = bank * matrix1000_->numberOfPatches() + slot;
+				auto patch = matrix1000_->decodePatch(message, MidiProgramNumber::fromZeroBase(programNumber));
+				if (patch) {
+					patches_[programNumber] = patch;
+					state.received.set(slot);
+				}
+				else {
+					programFailed(bank, slot);
+				}
+			}
+			if (onProgress_) {
+				onProgress_(bank, (int)(state.received & state.wanted).count(), (int)state.wanted.count());
+			}
+
+			if (usesSinglePatchRequests()) {
+				outstandingRequests_.erase(std::remove(outstandingRequests_.begin(), outstandingRequests_.end(), slot), outstandingRequests_.end());
+				if (state.isDone()) {
+					bankCompleted();
+				}
+				else {
+					requestNextSinglePatches();
+				}
+			}
+			break;
+		}
+		case Matrix1000::MASTER_DATA:
+			lastActivity_ = Time::getMillisecondCounter();
+			if (includeMasterData_ && !masterData_) {
+				auto loaded = matrix1000_->loader()->loadData({ message }, DataStreamType(matrix1000_->settingsDataFileType()));
+				if (!loaded.empty()) {
+					masterData_ = loaded.front();
+				}
+			}
+			if (awaitingDumpEnd_) {
+				// The master data is the last message of a bank dump. Anything sent before it would arrive while the Matrix is still busy sending
+				// the split patches, and requests arriving then usually get lost
+				awaitingDumpEnd_ = false;
+				bankDumpFinished();
+			}
+			else {
+				checkFinished();
+			}
+			break;
+		case Matrix1000::SPLIT_PATCH:
+			// Bogus split patches of the Matrix 6 heritage, they only tell us the synth is still talking
+			lastActivity_ = Time::getMillisecondCounter();
+			break;
+		default:
+			break;
+		}
+	}
+
+	void Matrix1000BackupEngine::programFailed(int bank, int slot)
+	{
+		int programNumber = bank * matrix1000_->numberOfPatches() + slot;
+		auto &state = bankState_[bank];
+		if (!recoveryEnabled_ || ++failures_[programNumber] >= kMaximumRecoveryAttempts) {
+			SimpleLogger::instance()->postMessage((boost::format("Matrix 1000: Program %03d arrived broken, giving up on it") % programNumber).str());
+			state.givenUp.set(slot);
+		}
+		else {
+			SimpleLogger::instance()->postMessage((boost::format("Matrix 1000: Program %03d arrived broken, requesting it again") % programNumber).str());
+			if (usesSinglePatchRequests()) {
+				// Let requestNextSinglePatches() come around to this slot once more
+				nextRequest_ = std::min(nextRequest_, slot);
+			}
+		}
+	}
+
+	void Matrix1000BackupEngine::bankDumpFinished()
+	{
+		auto const &state = bankState_[banks_[receivingBank_]];
+		if (state.isDone()) {
+			bankCompleted();
+		}
+		else {
+			requestMissingAsSinglePatches();
+		}
+	}
+
+	void Matrix1000BackupEngine::requestMissingAsSinglePatches()
+	{
+		// Some programs were broken or lost. Instead of another bank dump, ask for just those
+		recovering_ = true;
+		outstandingRequests_.clear();
+		nextRequest_ = 0;
+		send_({ matrix1000_->createBankSelect(MidiBankNumber::fromZeroBase(banks_[receivingBank_])), matrix1000_->createBankUnlock() });
+		requestNextSinglePatches();
+	}
+
+	void Matrix1000BackupEngine::bankCompleted()
+	{
+		if (receivingBank_ + 1 < banks_.size()) {
+			receivingBank_++;
+			requestBank(receivingBank_);
+		}
+		else {
+			checkFinished();
+		}
+	}
+
+	void Matrix1000BackupEngine::checkFinished()
+	{
+		if (finished_) {
+			return;
+		}
+		bool allBanksDone = std::all_of(bankState_.begin(), bankState_.end(), [](std::pair<const int, BankState> const &bank) {
+			return bank.second.isDone();
+		});
+		// The master data only comes with a bank dump, so in single patch mode, or when it got lost, we ask for it separately at the end
+		if (allBanksDone && includeMasterData_ && !masterData_) {
+			if (!awaitingDumpEnd_) {
+				send_({ matrix1000_->createRequest(Matrix1000::MASTER, 0) });
+			}
+			return;
+		}
+		if (allBanksDone) {
+			finished_ = true;
+			if (onFinished_) {
+				onFinished_();
+			}
+		}
+	}
+
+	void Matrix1000BackupEngine::checkForStall(int timeoutMS)
+	{
+		if (finished_ || (int)(Time::getMillisecondCounter() - lastActivity_) < timeoutMS) {
+			return;
+		}
+		lastActivity_ = Time::getMillisecondCounter();
+
+		auto const &state = bankState_[banks_[receivingBank_]];
+		if (awaitingDumpEnd_) {
+			// The bank dump broke off. Ask again only for what is missing: nothing, the master data to close the dump, or some of the programs
+			if ((state.arrived & state.wanted).none()) {
+				requestBank(receivingBank_);
+			}
+			else if (!state.isDone()) {
+				awaitingDumpEnd_ = false;
+				requestMissingAsSinglePatches();
+			}
+			else if (includeMasterData_ && !masterData_) {
+				send_({ matrix1000_->createRequest(Matrix1000::MASTER, 0) });
+			}
+			else {
+				awaitingDumpEnd_ = false;
+				bankCompleted();
+			}
+		}
+		else if (state.isDone() && usesSinglePatchRequests()) {
+			// Only the master data request got lost
+			send_({ matrix1000_->createRequest(Matrix1000::MASTER, 0) });
+		}
+		else if (usesSinglePatchRequests()) {
+			// Select the bank again, as we don't know how much of the last messages arrived
+			outstandingRequests_.clear();
+			nextRequest_ = 0;
+			send_({ matrix1000_->createBankSelect(MidiBankNumber::fromZeroBase(banks_[receivingBank_])), matrix1000_->createBankUnlock() });
+			requestNextSinglePatches();
+		}
+		else {
+			requestBank(receivingBank_);
+		}
+	}
+
+	bool Matrix1000BackupEngine::isFinished() const
+	{
+		return finished_;
+	}
+
+	TPatchVector Matrix1000BackupEngine::patches() const
+	{
+		TPatchVector result;
+		result.reserve(patches_.size());
+		for (auto const &patch : patches_) {
+			result.push_back(patch.second);
+		}
+		return result;
+	}
+
+	std::vector<int> Matrix1000BackupEngine::failedPrograms() const
+	{
+		std::vector<int> result;
+		for (auto const &bank : bankState_) {
+			for (int slot = 0; slot < (int)bank.second.givenUp.size(); slot++) {
+				if (bank.second.givenUp.test(slot) && bank.second.wanted.test(slot)) {
+					result.push_back(bank.first * matrix1000_->numberOfPatches() + slot);
+				}
+			}
+		}
+		return result;
+	}
+
+	std::shared_ptr<DataFile> Matrix1000BackupEngine::masterData() const
+	{
+		return masterData_;
+	}
+
+}
@@ -0,0 +1,95 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Matrix1000.h"
+
+#include <bitset>
+#include <map>
+
+namespace midikraft {
+
+	// Backs up a selection of programs, up to the full unit, while keeping the MIDI link busy. The engine does no I/O itself:
+	// outgoing messages go to the send function given, and every incoming message needs to be fed into handleMessage().
+	class Matrix1000BackupEngine {
+	public:
+		enum class Mode {
+			BANK_DUMPS, // One bank and master request per bank. The next bank is requested when the master data closing the current dump arrived
+			SINGLE_PATCHES // Request only the programs wanted, good for partial backups as it skips the 80 split patches and the master data
+		};
+
+		typedef std::function<void(std::vector<MidiMessage> const &messages)> TSendFunction;
+		typedef std::function<void(int bank, int programsReceived, int programsExpected)> TProgressHandler;
+		typedef std::function<void()> TFinishedHandler;
+
+		Matrix1000BackupEngine(Matrix1000 *matrix1000, TSendFunction send);
+
+		void setProgressHandler(TProgressHandler handler);
+		void setFinishedHandler(TFinishedHandler handler);
+
+		// On by default. Program dumps with a wrong checksum or length are requested again as single patches, also after a bank dump,
+		// up to a few times per program. Without recovery, or when that doesn't help either, the program is given up and listed by failedPrograms()
+		void setRecoveryEnabled(bool enabled);
+
+		// Program numbers are 0 to 999. In BANK_DUMPS mode a bank is requested if any of its programs is wanted, but only the wanted ones are kept
+		void start(std::vector<int> const &programNumbers, Mode mode, bool includeMasterData = false);
+		void startFullBackup(Mode mode = Mode::BANK_DUMPS, bool includeMasterData = true);
+
+		void handleMessage(MidiMessage const &message);
+
+		// Call this regularly, e.g. from a timer. If nothing arrived for the timeout given, the outstanding requests are sent again
+		void checkForStall(int timeoutMS = 2000);
+
+		bool isFinished() const;
+		TPatchVector patches() const; // In order of program number
+		std::vector<int> failedPrograms() const; // Program numbers given up on
+		std::shared_ptr<DataFile> masterData() const;
+
+	private:
+		struct BankState {
+			std::bitset<100> wanted;
+			std::bitset<100> arrived; // Any program dump, intact or not, to know how far a broken off bank dump got
+			std::bitset<100> received;
+			std::bitset<100> givenUp;
+
+			bool isDone() const { return ((received | givenUp) & wanted) == wanted; }
+		};
+
+		void requestBank(size_t bankIndex);
+		void requestNextSinglePatches();
+		void bankDumpFinished();
+		void requestMissingAsSinglePatches();
+		void bankCompleted();
+		void checkFinished();
+		bool usesSinglePatchRequests() const;
+		void programFailed(int bank, int slot);
+
+		Matrix1000 *matrix1000_;
+		TSendFunction send_;
+		TProgressHandler onProgress_;
+		TFinishedHandler onFinished_;
+
+		Mode mode_;
+		bool includeMasterData_;
+		bool recoveryEnabled_;
+		bool recovering_; // BANK_DUMPS mode: the current bank dump is through, the broken programs are requested as single patches
+		bool awaitingDumpEnd_; // BANK_DUMPS mode: a bank dump was requested and its master data didn't arrive yet
+		std::map<int, int> failures_; // Number of broken dumps by program number
+		std::vector<int> banks_; // Zero based bank numbers in request order
+		std::map<int, BankState> bankState_;
+		size_t receivingBank_; // Index into banks_ of the bank whose program dumps arrive right now
+		std::vector<int> outstandingRequests_; // SINGLE_PATCHES mode: program numbers within the current bank requested but not received
+		int nextRequest_; // SINGLE_PATCHES mode: next slot of the current bank to consider for requesting
+		std::map<int, std::shared_ptr<DataFile>> patches_; // By program number, 0 to 999
+		std::shared_ptr<DataFile> masterData_;
+		uint32 lastActivity_;
+		bool finished_;
+	};
+
+}
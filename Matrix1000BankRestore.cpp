@@ -0,0 +1,209 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000BankRestore.h"
+
+namespace midikraft {
+
+	Matrix1000BankRestore::Matrix1000BankRestore(Matrix1000 *matrix1000, TSendFunction send) :
+		Thread("Matrix1000BankRestore"), matrix1000_(matrix1000), send_(send), bank_(0), awaitedSlot_(-1)
+	{
+	}
+
+	Matrix1000BankRestore::~Matrix1000BankRestore()
+	{
+		stopThread(5000);
+	}
+
+	void Matrix1000BankRestore::setProgressHandler(TProgressHandler handler)
+	{
+		onProgress_ = handler;
+	}
+
+	bool Matrix1000BankRestore::start(int bank, TPatchVector const &patches, Options const &options, TFinishedHandler onFinished)
+	{
+		if (isThreadRunning() || bank < 0 || bank >= matrix1000_->numberOfBanks() || patches.size() > (size_t) matrix1000_->numberOfPatches()) {
+			jassertfalse;
+			return false;
+		}
+		bank_ = bank;
+		patches_ = patches;
+		options_ = options;
+		onFinished_ = onFinished;
+		startThread();
+		return true;
+	}
+
+	void Matrix1000BankRestore::cancel()
+	{
+		signalThreadShouldExit();
+		notify();
+		replyArrived_.signal();
+	}
+
+	bool Matrix1000BankRestore::isRunning() const
+	{
+		return isThreadRunning();
+	}
+
+	void Matrix1000BankRestore::handleMessage(MidiMessage const &message)
+	{
+		int awaited = awaitedSlot_;
+		if (awaited == -1) {
+			return;
+		}
+		auto classification = Matrix1000::classify(message);
+		if (classification.type == Matrix1000::PROGRAM_DUMP && classification.number == awaited) {
+			std::lock_guard<std::mutex> lock(replyLock_);
+			reply_ = matrix1000_->patchFromProgramDumpSysex(message);
+			awaitedSlot_ = -1;
+			replyArrived_.signal();
+		}
+	}
+
+	int Matrix1000BankRestore::wireTimeMS(MidiMessage const &message) const
+	{
+		// MIDI sends 3125 bytes per second, 10 bits per byte at 31250 baud
+		return (message.getRawDataSize() * 1000 + 3124) / 3125;
+	}
+
+	bool Matrix1000BankRestore::verify(int slot)
+	{
+		{
+			std::lock_guard<std::mutex> lock(replyLock_);
+			reply_.reset();
+			replyArrived_.reset();
+			awaitedSlot_ = slot;
+		}
+		send_(matrix1000_->requestPatch(bank_ * matrix1000_->numberOfPatches() + slot));
+		bool arrived = replyArrived_.wait(options_.replyTimeoutMS);
+		awaitedSlot_ = -1;
+
+		std::lock_guard<std::mutex> lock(replyLock_);
+		if (!arrived || !reply_) {
+			return false;
+		}
+		// The Matrix 1000 clears the name when storing, so only the voice data can be compared
+		return matrix1000_->voiceFingerprint(reply_) == matrix1000_->voiceFingerprint(patches_[slot])
+			&& matrix1000_->filterVoiceRelevantData(reply_) == matrix1000_->filterVoiceRelevantData(patches_[slot]);
+	}
+
+	void Matrix1000BankRestore::run()
+	{
+		std::vector<int> slots;
+		for (int slot = 0; slot < (int)patches_.size(); slot++) {
+			if (patches_[slot]) {
+				slots.push_back(slot);
+			}
+		}
+
+		Result result = { true, 0, 0, 0.0, options_.initialGapMS };
+		int gapMS = options_.initialGapMS;
+		int retries = 0;
+		Random random;
+		double startTime = Time::getMillisecondCounterHiRes();
+
+		auto selectBank = [this]() {
+			send_({ matrix1000_->createBankSelect(MidiBankNumber::fromZeroBase(bank_)), matrix1000_->createBankUnlock() });
+		};
+		auto writeProgram = [this, &gapMS](int slot) {
+			auto programDump = matrix1000_->patchToProgramDumpSysex(patches_[slot], MidiProgramNumber::fromZeroBase(slot));
+			send_(programDump);
+			int pauseMS = gapMS;
+			for (auto const &message : programDump) {
+				pauseMS += wireTimeMS(message);
+			}
+			wait(pauseMS);
+		};
+		// The last gap that failed. A window that passes its probe can still have lost a program, so the gap never shrinks down to this again
+		int failedGapMS = -1;
+		auto backOff = [this, &gapMS, &failedGapMS]() {
+			failedGapMS = gapMS;
+			gapMS = std::min(options_.maximumGapMS, std::max(gapMS, 1) * 2);
+		};
+		selectBank();
+
+		size_t next = 0;
+		size_t lastVerified = 0; // Everything before this index into slots has been confirmed, or was written before a confirmed one
+		while (next < slots.size() && !threadShouldExit()) {
+			writeProgram(slots[next]);
+			next++;
+
+			bool checkNow = options_.verifyEvery > 0 && (next - lastVerified >= (size_t)options_.verifyEvery || next == slots.size());
+			if (checkNow && !threadShouldExit()) {
+				int probe = slots[lastVerified + (size_t)random.nextInt((int)(next - lastVerified))];
+				if (verify(probe)) {
+					lastVerified = next;
+					retries = 0;
+					int floorMS = std::max(options_.minimumGapMS, std::min(options_.maximumGapMS, failedGapMS + 1));
+					gapMS = std::max(floorMS, gapMS - options_.gapDecreaseMS);
+				}
+				else {
+					// Too fast, or the message got lost on the way. Back off and write the whole window again
+					result.verificationsFailed++;
+					if (++retries > options_.maximumRetries) {
+						result.success = false;
+						break;
+					}
+					backOff();
+					next = lastVerified;
+					selectBank();
+				}
+			}
+
+			result.programsWritten = (int)next;
+			double seconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+			result.programsPerSecond = seconds > 0.0 ? result.programsWritten / seconds : 0.0;
+			if (onProgress_) {
+				onProgress_(result.programsWritten, (int)slots.size(), result.programsPerSecond);
+			}
+		}
+
+		// The probes only sample each window, so before reporting success every program written is read back once. Those that don't match
+		// are written again at a slower pace and checked again
+		if (result.success && options_.verifyEvery > 0 && !threadShouldExit()) {
+			std::vector<int> unconfirmed = slots;
+			int rounds = 0;
+			while (!unconfirmed.empty() && !threadShouldExit()) {
+				std::vector<int> mismatched;
+				for (int slot : unconfirmed) {
+					if (threadShouldExit()) {
+						break;
+					}
+					if (!verify(slot)) {
+						mismatched.push_back(slot);
+					}
+				}
+				unconfirmed = mismatched;
+				if (unconfirmed.empty() || threadShouldExit()) {
+					break;
+				}
+				result.verificationsFailed += (int)unconfirmed.size();
+				if (++rounds > options_.maximumRetries) {
+					result.success = false;
+					break;
+				}
+				backOff();
+				selectBank();
+				for (int slot : unconfirmed) {
+					if (threadShouldExit()) {
+						break;
+					}
+					writeProgram(slot);
+				}
+			}
+		}
+
+		if (threadShouldExit()) {
+			result.success = false;
+		}
+		result.finalGapMS = gapMS;
+		if (onFinished_) {
+			onFinished_(result);
+		}
+	}
+
+}
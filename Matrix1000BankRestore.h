@@ -0,0 +1,79 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Matrix1000.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace midikraft {
+
+	// Writes the programs of one bank with adaptive pacing. The Matrix 1000 drops program dumps that arrive faster than it can write
+	// them to its EEPROM, but nothing acknowledges a write. So every few programs a random one of those just sent is read back:
+	// a match shortens the gap between messages, but never down to a gap that failed before, a mismatch doubles it and sends everything
+	// since the last good check again. At the end every program written is read back, the restore only succeeds if all of them match.
+	// Runs on its own thread. Outgoing messages go to the send function, incoming messages need to be fed into handleMessage().
+	class Matrix1000BankRestore : private Thread {
+	public:
+		struct Options {
+			int verifyEvery = 10; // Read back one random program out of every n written, 0 disables all verification and keeps the initial gap
+			int initialGapMS = 60; // Pause after the time the program dump needs on the wire
+			int minimumGapMS = 2;
+			int maximumGapMS = 1000;
+			int gapDecreaseMS = 5;
+			int replyTimeoutMS = 1500;
+			int maximumRetries = 5;
+		};
+
+		struct Result {
+			bool success;
+			int programsWritten;
+			int verificationsFailed;
+			double programsPerSecond;
+			int finalGapMS;
+		};
+
+		typedef std::function<void(std::vector<MidiMessage> const &messages)> TSendFunction;
+		typedef std::function<void(int programsWritten, int programsTotal, double programsPerSecond)> TProgressHandler;
+		typedef std::function<void(Result const &result)> TFinishedHandler;
+
+		Matrix1000BankRestore(Matrix1000 *matrix1000, TSendFunction send);
+		virtual ~Matrix1000BankRestore() override;
+
+		void setProgressHandler(TProgressHandler handler);
+
+		// patches[i] is written to program i of the bank given, null entries are skipped
+		bool start(int bank, TPatchVector const &patches, Options const &options, TFinishedHandler onFinished);
+		void cancel();
+		bool isRunning() const;
+
+		void handleMessage(MidiMessage const &message);
+
+	private:
+		void run() override;
+		bool verify(int slot);
+		int wireTimeMS(MidiMessage const &message) const;
+
+		Matrix1000 *matrix1000_;
+		TSendFunction send_;
+		TProgressHandler onProgress_;
+		TFinishedHandler onFinished_;
+
+		int bank_;
+		TPatchVector patches_;
+		Options options_;
+
+		std::mutex replyLock_;
+		std::atomic<int> awaitedSlot_;
+		std::shared_ptr<DataFile> reply_;
+		WaitableEvent replyArrived_;
+	};
+
+}
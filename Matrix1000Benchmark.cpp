@@ -0,0 +1,746 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+// The matrix1000-bench executable, built with the CMake option MATRIX1000_BENCHMARK. It times the hot paths of the adapter on data
+// generated from a fixed seed, so two runs do exactly the same work, and then runs the backup engine and the bank restore against an
+// emulated Matrix 1000. Every benchmark first checks that its result is right, a wrong result is a failure no matter how fast it was.
+//
+//   matrix1000-bench [--filter <text>] [--save <file>] [--baseline <file>] [--tolerance <percent>]
+//
+// Save the timings of a known good build with --save, and compare later builds with --baseline. Anything slower than the tolerance
+// (default 20 percent) is reported and gives a non-zero exit code.
+
+#include "JuceHeader.h"
+
+#include "Matrix1000.h"
+#include "Matrix1000Patch.h"
+#include "Matrix1000ParamDefinition.h"
+#include "Matrix1000Library.h"
+#include "Matrix1000BackupEngine.h"
+#include "Matrix1000BankRestore.h"
+#include "Matrix1000Instrumentation.h"
+
+#include "MidiHelpers.h"
+
+#include <boost/format.hpp>
+
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+
+using namespace midikraft;
+
+namespace {
+
+	const int64 kSeed = 1000;
+	const int kNumberOfBanks = 10;
+	const int kProgramsPerBank = 100;
+	const int kSplitPatches = 0x50;
+	const int kMasterDataSize = 172;
+	const int kRestoredPrograms = 20; // The restore runs in real time at MIDI speed, so only a part of a bank
+	const double kMinimumSecondsPerBenchmark = 0.5;
+	const int kMinimumRounds = 5;
+
+	// Anything written to a volatile can't be optimized away, so the work measured is really done
+	volatile uint64 sSink;
+
+	// Counts the messages instead of showing them, the broken dumps of the recovery run would flood the console
+	class BenchmarkLogger : public SimpleLogger {
+	public:
+		void postMessage(const String &message) override {
+			ignoreUnused(message);
+			messages_++;
+		}
+
+		int numberOfMessages() const { return messages_; }
+
+	private:
+		std::atomic<int> messages_ { 0 };
+	};
+
+	class Benchmarks {
+	public:
+		explicit Benchmarks(std::string const &filter) : filter_(filter), failures_(0) {
+		}
+
+		bool wanted(std::string const &name) const {
+			return filter_.empty() || name.find(filter_) != std::string::npos;
+		}
+
+		// Calls the round function until the minimum time is used up, each call doing operationsPerRound operations.
+		// The fastest round counts, as it has seen the least interference from the rest of the machine
+		void run(std::string const &name, int operationsPerRound, std::function<void()> round) {
+			if (!wanted(name)) {
+				return;
+			}
+			round(); // Warm up caches and lazily built tables
+			double fastest = std::numeric_limits<double>::max();
+			double total = 0.0;
+			int rounds = 0;
+			while (rounds < kMinimumRounds || total < kMinimumSecondsPerBenchmark) {
+				int64 start = Time::getHighResolutionTicks();
+				round();
+				double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+				fastest = std::min(fastest, seconds);
+				total += seconds;
+				rounds++;
+			}
+			report(name, fastest * 1e9 / operationsPerRound);
+		}
+
+		// For the end to end runs that take real time and are only done once
+		void report(std::string const &name, double nanosecondsPerOperation) {
+			results_[name] = nanosecondsPerOperation;
+			std::cout << (boost::format("%-56s %14.1f ns/op") % name % nanosecondsPerOperation).str() << std::endl;
+		}
+
+		void check(bool condition, std::string const &what) {
+			if (!condition) {
+				std::cout << "FAILED: " << what << std::endl;
+				failures_++;
+			}
+		}
+
+		int failures() const { return failures_; }
+
+		void save(std::string const &fileName) const {
+			std::ofstream out(fileName);
+			for (auto const &result : results_) {
+				out << result.first << '\t' << result.second << '\n';
+			}
+		}
+
+		// Returns the number of benchmarks slower than the baseline plus the tolerance
+		int compare(std::string const &fileName, double tolerancePercent) const {
+			std::ifstream in(fileName);
+			if (!in) {
+				std::cout << "Can't read baseline " << fileName << std::endl;
+				return 1;
+			}
+			int regressions = 0;
+			std::string line;
+			while (std::getline(in, line)) {
+				auto tab = line.find('\t');
+				if (tab == std::string::npos) {
+					continue;
+				}
+				auto found = results_.find(line.substr(0, tab));
+				if (found == results_.end()) {
+					continue;
+				}
+				double baseline = std::stod(line.substr(tab + 1));
+				double change = baseline > 0.0 ? (found->second - baseline) / baseline * 100.0 : 0.0;
+				if (change > tolerancePercent) {
+					std::cout << (boost::format("REGRESSION: %s is %.1f%% slower (%.1f ns/op, was %.1f ns/op)") % found->first % change % found->second % baseline).str() << std::endl;
+					regressions++;
+				}
+			}
+			return regressions;
+		}
+
+	private:
+		std::string filter_;
+		std::map<std::string, double> results_;
+		int failures_;
+	};
+
+	Synth::PatchData randomPatchData(Random &random) {
+		Synth::PatchData data(kMatrix1000PatchDataSize);
+		for (auto &byte : data) {
+			byte = (uint8)random.nextInt(256);
+		}
+		return data;
+	}
+
+	MidiMessage programDump(int slot, const uint8 *patchData) {
+		std::vector<uint8> sysex(4 + 2 * kMatrix1000PatchDataSize + 1);
+		sysex[0] = 0x10;
+		sysex[1] = 0x06;
+		sysex[2] = 0x01;
+		sysex[3] = (uint8)slot;
+		Matrix1000::escapeSysex(patchData, kMatrix1000PatchDataSize, &sysex[4], (int)sysex.size() - 4);
+		return MidiHelpers::sysexMessage(sysex);
+	}
+
+	MidiMessage splitPatch(int number) {
+		// The 36 bytes content doesn't matter, nobody reads split patches
+		std::vector<uint8> sysex(4 + 2 * 36 + 1);
+		sysex[0] = 0x10;
+		sysex[1] = 0x06;
+		sysex[2] = 0x02;
+		sysex[3] = (uint8)number;
+		std::vector<uint8> data(36);
+		Matrix1000::escapeSysex(data.data(), (int)data.size(), &sysex[4], (int)sysex.size() - 4);
+		return MidiHelpers::sysexMessage(sysex);
+	}
+
+	MidiMessage masterData() {
+		// All zero is a valid setting for every master parameter
+		std::vector<uint8> sysex(4 + 2 * kMasterDataSize + 1);
+		sysex[0] = 0x10;
+		sysex[1] = 0x06;
+		sysex[2] = 0x03;
+		sysex[3] = 0x03;
+		std::vector<uint8> data(kMasterDataSize);
+		Matrix1000::escapeSysex(data.data(), (int)data.size(), &sysex[4], (int)sysex.size() - 4);
+		return MidiHelpers::sysexMessage(sysex);
+	}
+
+	// What the Matrix 1000 sends for one bank and master request
+	std::vector<MidiMessage> bankDump(std::vector<Synth::PatchData> const &programs, int bank) {
+		std::vector<MidiMessage> result;
+		for (int slot = 0; slot < kProgramsPerBank; slot++) {
+			result.push_back(programDump(slot, programs[bank * kProgramsPerBank + slot].data()));
+		}
+		for (int split = 0; split < kSplitPatches; split++) {
+			result.push_back(splitPatch(split));
+		}
+		result.push_back(masterData());
+		return result;
+	}
+
+	// Answers the sysex of the backup engine and the bank restore like a real Matrix 1000 does: bank select, bank dumps with 100 programs,
+	// 80 split patches and the master data, single patch requests, and program dump writes. A write arriving while the EEPROM is still
+	// busy with the previous one is dropped without a word, which is what the adaptive pacing of the restore has to find out.
+	// Replies are queued, deliverNext() hands them out in order, so the host sees them one by one as if they came over the wire.
+	// While a bank dump is still being sent, the unit is busy and ignores everything arriving, up to and including the master data.
+	class Matrix1000Emulator {
+	public:
+		Matrix1000Emulator(std::vector<Synth::PatchData> const &programs, double eepromWriteMS) :
+			programs_(programs), eepromWriteMS_(eepromWriteMS), bank_(0), corruptEvery_(0), dumpsSent_(0), writesDropped_(0), messagesIgnored_(0), bytesOnWire_(0), busyUntil_(0.0), bankDumpLeft_(0)
+		{
+			jassert(programs_.size() == (size_t)(kNumberOfBanks * kProgramsPerBank));
+		}
+
+		// Flips a nibble in every nth program dump sent, so the checksum fails. 0 sends everything intact
+		void setCorruptEvery(int n) {
+			corruptEvery_ = n;
+		}
+
+		void receive(std::vector<MidiMessage> const &messages) {
+			std::lock_guard<std::mutex> lock(lock_);
+			for (auto const &message : messages) {
+				bytesOnWire_ += (uint64)message.getRawDataSize();
+				if (bankDumpLeft_ > 0) {
+					messagesIgnored_++;
+				}
+				else if (message.isSysEx()) {
+					receiveSysex(message.getSysExData(), message.getSysExDataSize());
+				}
+			}
+		}
+
+		bool deliverNext(std::function<void(MidiMessage const &)> const &handler) {
+			MidiMessage next;
+			{
+				std::lock_guard<std::mutex> lock(lock_);
+				if (outgoing_.empty()) {
+					return false;
+				}
+				next = outgoing_.front();
+				outgoing_.pop_front();
+				bytesOnWire_ += (uint64)next.getRawDataSize();
+				// Nothing is queued behind a bank dump, as the unit ignores requests while sending it
+				if (bankDumpLeft_ > 0) {
+					bankDumpLeft_--;
+				}
+			}
+			handler(next);
+			return true;
+		}
+
+		// What all of the traffic takes at MIDI speed, 3125 bytes per second
+		double wireSeconds() const {
+			std::lock_guard<std::mutex> lock(lock_);
+			return bytesOnWire_ / 3125.0;
+		}
+
+		Synth::PatchData program(int programNumber) const {
+			std::lock_guard<std::mutex> lock(lock_);
+			return programs_[programNumber];
+		}
+
+		int writesDropped() const {
+			std::lock_guard<std::mutex> lock(lock_);
+			return writesDropped_;
+		}
+
+		// Messages that arrived while a bank dump was being sent
+		int messagesIgnored() const {
+			std::lock_guard<std::mutex> lock(lock_);
+			return messagesIgnored_;
+		}
+
+		bool isSendingBankDump() const {
+			std::lock_guard<std::mutex> lock(lock_);
+			return bankDumpLeft_ > 0;
+		}
+
+	private:
+		void receiveSysex(const uint8 *data, int size) {
+			if (size < 3 || data[0] != 0x10 || data[1] != 0x06) {
+				return;
+			}
+			switch (data[2]) {
+			case 0x0a: // Set bank
+				if (size > 3 && data[3] < kNumberOfBanks) {
+					bank_ = data[3];
+				}
+				break;
+			case 0x04: // Request data
+				if (size > 4) {
+					request(data[3], data[4]);
+				}
+				break;
+			case 0x01: // Single patch data, written to the current bank
+				if (size > 4 && data[3] < kProgramsPerBank) {
+					write(data[3], data + 4, size - 4);
+				}
+				break;
+			default:
+				// Bank unlock and everything else needs no answer
+				break;
+			}
+		}
+
+		void request(int type, int number) {
+			switch (type) {
+			case 0: // Bank and master
+				for (int slot = 0; slot < kProgramsPerBank; slot++) {
+					sendProgram(slot);
+				}
+				for (int split = 0; split < kSplitPatches; split++) {
+					outgoing_.push_back(splitPatch(split));
+				}
+				outgoing_.push_back(masterData());
+				bankDumpLeft_ = (int)outgoing_.size();
+				break;
+			case 1: // Single patch
+				if (number < kProgramsPerBank) {
+					sendProgram(number);
+				}
+				break;
+			case 3: // Master data
+				outgoing_.push_back(masterData());
+				break;
+			default:
+				break;
+			}
+		}
+
+		void sendProgram(int slot) {
+			auto message = programDump(slot, programs_[bank_ * kProgramsPerBank + slot].data());
+			if (corruptEvery_ > 0 && ++dumpsSent_ % corruptEvery_ == 0) {
+				// One of the nibbles of the name, the checksum doesn't match anymore
+				std::vector<uint8> sysex(message.getSysExData(), message.getSysExData() + message.getSysExDataSize());
+				sysex[4] ^= 0x01;
+				message = MidiHelpers::sysexMessage(sysex);
+			}
+			outgoing_.push_back(message);
+		}
+
+		void write(int slot, const uint8 *escaped, int size) {
+			// A program dump takes its time on the wire, and the EEPROM write only starts after the last byte
+			double now = Time::getMillisecondCounterHiRes();
+			if (now < busyUntil_) {
+				writesDropped_++;
+				return;
+			}
+			busyUntil_ = now + (4 + size + 2) * 1000.0 / 3125.0 + eepromWriteMS_;
+			Synth::PatchData data(kMatrix1000PatchDataSize);
+			if (Matrix1000::unescapeSysex(escaped, size, data.data(), (int)data.size()) == kMatrix1000PatchDataSize) {
+				programs_[bank_ * kProgramsPerBank + slot] = data;
+			}
+		}
+
+		mutable std::mutex lock_;
+		std::vector<Synth::PatchData> programs_;
+		double eepromWriteMS_;
+		int bank_;
+		int corruptEvery_;
+		int dumpsSent_;
+		int writesDropped_;
+		int messagesIgnored_;
+		uint64 bytesOnWire_;
+		double busyUntil_;
+		int bankDumpLeft_; // Messages of the bank dump still to be sent
+		std::deque<MidiMessage> outgoing_;
+	};
+
+	void benchmarkCodec(Benchmarks &benchmarks, std::vector<Synth::PatchData> const &programs) {
+		const int kPatches = 1000;
+		std::vector<uint8> escaped(2 * kMatrix1000PatchDataSize + 1);
+		std::vector<uint8> decoded(kMatrix1000PatchDataSize);
+
+		Matrix1000::escapeSysex(programs[0].data(), kMatrix1000PatchDataSize, escaped.data(), (int)escaped.size());
+		int written = Matrix1000::unescapeSysex(escaped.data(), (int)escaped.size(), decoded.data(), (int)decoded.size());
+		benchmarks.check(written == kMatrix1000PatchDataSize && decoded == programs[0], "escape/unescape round trip gives back the patch");
+		escaped[3] ^= 0x01;
+		benchmarks.check(Matrix1000::unescapeSysex(escaped.data(), (int)escaped.size(), decoded.data(), (int)decoded.size()) == -1, "unescape detects a wrong checksum");
+
+		benchmarks.run("escapeSysex, one patch", kPatches, [&]() {
+			for (int i = 0; i < kPatches; i++) {
+				sSink = sSink + (uint64)Matrix1000::escapeSysex(programs[i].data(), kMatrix1000PatchDataSize, escaped.data(), (int)escaped.size());
+			}
+		});
+
+		std::vector<std::vector<uint8>> dumps;
+		for (int i = 0; i < kPatches; i++) {
+			std::vector<uint8> dump(escaped.size());
+			Matrix1000::escapeSysex(programs[i].data(), kMatrix1000PatchDataSize, dump.data(), (int)dump.size());
+			dumps.push_back(dump);
+		}
+		benchmarks.run("unescapeSysex, one patch", kPatches, [&]() {
+			for (int i = 0; i < kPatches; i++) {
+				sSink = sSink + (uint64)Matrix1000::unescapeSysex(dumps[i].data(), (int)dumps[i].size(), decoded.data(), (int)decoded.size());
+			}
+		});
+
+		Matrix1000 matrix1000;
+		benchmarks.run("escape/unescape round trip, vector API", kPatches, [&]() {
+			for (int i = 0; i < kPatches; i++) {
+				auto sysex = matrix1000.escapeSysex(programs[i]);
+				sSink = sSink + matrix1000.unescapeSysex(sysex.data(), (int)sysex.size()).size();
+			}
+		});
+	}
+
+	void benchmarkStreams(Benchmarks &benchmarks, std::vector<Synth::PatchData> const &programs) {
+		Matrix1000 matrix1000;
+		std::vector<MidiMessage> fullDump;
+		for (int bank = 0; bank < kNumberOfBanks; bank++) {
+			auto dump = bankDump(programs, bank);
+			std::copy(dump.begin(), dump.end(), std::back_inserter(fullDump));
+		}
+
+		auto loaded = matrix1000.loadPatchesFromStream(fullDump);
+		bool allThere = loaded.size() == programs.size();
+		for (size_t i = 0; allThere && i < loaded.size(); i++) {
+			allThere = loaded[i] && loaded[i]->data() == programs[i];
+		}
+		benchmarks.check(allThere, "loadPatchesFromStream finds all programs of 10 banks");
+		benchmarks.check(matrix1000.loadPatchesFromStreamParallel(fullDump).size() == programs.size(), "loadPatchesFromStreamParallel finds all programs of 10 banks");
+
+		benchmarks.run("loadPatchesFromStream, 10 banks", 1, [&]() {
+			sSink = sSink + matrix1000.loadPatchesFromStream(fullDump).size();
+		});
+		benchmarks.run("loadPatchesFromStreamParallel, 10 banks", 1, [&]() {
+			sSink = sSink + matrix1000.loadPatchesFromStreamParallel(fullDump).size();
+		});
+		benchmarks.run("Matrix1000Library::addFromStream, 10 banks", 1, [&]() {
+			Matrix1000Library library(programs.size());
+			sSink = sSink + library.addFromStream(fullDump);
+		});
+
+		// The librarian calls isStreamComplete() after every message that arrived, with the vector growing each time
+		auto oneBank = bankDump(programs, 0);
+		auto growingStream = [&]() {
+			std::vector<MidiMessage> stream;
+			int completions = 0;
+			for (auto const &message : oneBank) {
+				stream.push_back(message);
+				if (matrix1000.isStreamComplete(stream, StreamLoadCapability::StreamType::BANK_DUMP)) {
+					completions++;
+				}
+			}
+			return completions;
+		};
+		// Only the master data at the very end completes it
+		benchmarks.check(growingStream() == 1, "isStreamComplete is true only after the last message of a bank dump");
+		benchmarks.run("isStreamComplete, growing bank dump, per message", (int)oneBank.size(), [&]() {
+			sSink = sSink + (uint64)growingStream();
+		});
+	}
+
+	void benchmarkParameters(Benchmarks &benchmarks, std::vector<Synth::PatchData> const &programs) {
+		std::vector<std::shared_ptr<Matrix1000Patch>> patches;
+		std::vector<Matrix1000Patch const *> patchPointers;
+		for (size_t i = 0; i < programs.size(); i++) {
+			patches.push_back(std::make_shared<Matrix1000Patch>(programs[i], MidiProgramNumber::fromZeroBase((int)i)));
+			patchPointers.push_back(patches.back().get());
+		}
+		int numberOfValues = (int)patches.size() * kMatrix1000NumberOfSysexParams;
+
+		std::vector<int16> values;
+		Matrix1000ParamDefinition::extractAll(patchPointers, values);
+		bool same = values.size() == (size_t)numberOfValues;
+		for (size_t p = 0; same && p < patches.size(); p++) {
+			for (int id = 0; same && id < kMatrix1000NumberOfSysexParams; id++) {
+				same = values[p * kMatrix1000NumberOfSysexParams + id] == patches[p]->param((Matrix1000Param)id);
+			}
+		}
+		benchmarks.check(same, "extractAll gives the same values as param()");
+
+		benchmarks.run("Matrix1000Patch::param, all parameters of 1000 patches", numberOfValues, [&]() {
+			for (auto const &patch : patches) {
+				for (int id = 0; id < kMatrix1000NumberOfSysexParams; id++) {
+					sSink = sSink + (uint64)patch->param((Matrix1000Param)id);
+				}
+			}
+		});
+		benchmarks.run("extractAll, all parameters of 1000 patches", numberOfValues, [&]() {
+			Matrix1000ParamDefinition::extractAll(patchPointers, values);
+			sSink = sSink + (uint64)values[0];
+		});
+
+		auto definitions = patches[0]->allParameterDefinitions();
+		int numberOfTexts = (int)(patches.size() * definitions.size());
+		benchmarks.run("valueInPatchToText, all parameters of 1000 patches", numberOfTexts, [&]() {
+			for (auto const &patch : patches) {
+				for (auto const &definition : definitions) {
+					sSink = sSink + definition->valueInPatchToText(*patch).size();
+				}
+			}
+		});
+		std::vector<std::string const *> texts;
+		benchmarks.run("extractAllAsText, all parameters of 1000 patches", numberOfValues, [&]() {
+			Matrix1000ParamDefinition::extractAllAsText(patchPointers, texts);
+			sSink = sSink + texts[0]->size();
+		});
+	}
+
+	void benchmarkGlobalSettings(Benchmarks &benchmarks) {
+		Matrix1000 matrix1000;
+		auto dataFiles = matrix1000.loader()->loadData({ masterData() }, 0);
+		benchmarks.check(dataFiles.size() == 1, "the master data dump is loaded as one data file");
+		if (dataFiles.empty()) {
+			return;
+		}
+		auto settings = dataFiles[0];
+		matrix1000.setGlobalSettingsFromDataFile(settings);
+		auto snapshot = matrix1000.globalSettingsSnapshot();
+		benchmarks.check(snapshot && snapshot->masterData.size() == (size_t)kMasterDataSize, "the master data is published after loading");
+
+		benchmarks.run("setGlobalSettingsFromDataFile", 1, [&]() {
+			matrix1000.setGlobalSettingsFromDataFile(settings);
+		});
+		std::vector<uint8> escaped(2 * kMasterDataSize + 1);
+		benchmarks.run("escapeSysex, master data", 1, [&]() {
+			auto current = matrix1000.globalSettingsSnapshot();
+			sSink = sSink + (uint64)Matrix1000::escapeSysex(current->masterData.data(), (int)current->masterData.size(), escaped.data(), (int)escaped.size());
+		});
+		benchmarks.run("globalSettingsSnapshot, read all values", 1, [&]() {
+			auto current = matrix1000.globalSettingsSnapshot();
+			for (auto value : current->values) {
+				sSink = sSink + (uint64)value;
+			}
+		});
+	}
+
+	void benchmarkBackup(Benchmarks &benchmarks, std::vector<Synth::PatchData> const &programs) {
+		Matrix1000 matrix1000;
+
+		// Returns the wire time the backup would have taken, or a negative number if it didn't get everything right
+		auto backup = [&](Matrix1000BackupEngine::Mode mode, int corruptEvery) {
+			Matrix1000Emulator emulator(programs, 0.0);
+			emulator.setCorruptEvery(corruptEvery);
+			Matrix1000BackupEngine engine(&matrix1000, [&emulator](std::vector<MidiMessage> const &messages) {
+				emulator.receive(messages);
+			});
+			// The caller sends its next request when the backup finished, so the bank dump must be through by then
+			bool finishedDuringBankDump = false;
+			engine.setFinishedHandler([&]() {
+				finishedDuringBankDump = emulator.isSendingBankDump();
+			});
+			engine.startFullBackup(mode, mode == Matrix1000BackupEngine::Mode::BANK_DUMPS);
+			while (emulator.deliverNext([&engine](MidiMessage const &message) { engine.handleMessage(message); })) {
+			}
+			if (!engine.isFinished() || finishedDuringBankDump || emulator.messagesIgnored() > 0 || !engine.failedPrograms().empty()) {
+				return -1.0;
+			}
+			auto patches = engine.patches();
+			if (patches.size() != programs.size()) {
+				return -1.0;
+			}
+			for (size_t i = 0; i < patches.size(); i++) {
+				if (!patches[i] || patches[i]->data() != programs[i]) {
+					return -1.0;
+				}
+			}
+			return emulator.wireSeconds();
+		};
+
+		struct Run {
+			std::string name;
+			Matrix1000BackupEngine::Mode mode;
+			int corruptEvery;
+		};
+		std::vector<Run> runs = {
+			{ "backup engine, full backup with bank dumps", Matrix1000BackupEngine::Mode::BANK_DUMPS, 0 },
+			{ "backup engine, full backup with single patches", Matrix1000BackupEngine::Mode::SINGLE_PATCHES, 0 },
+			{ "backup engine, bank dumps with every 97th program broken", Matrix1000BackupEngine::Mode::BANK_DUMPS, 97 },
+		};
+		for (auto const &run : runs) {
+			if (!benchmarks.wanted(run.name)) {
+				continue;
+			}
+			double wireSeconds = backup(run.mode, run.corruptEvery);
+			benchmarks.check(wireSeconds >= 0.0, run.name + " gets all 1000 programs right, sending nothing into a bank dump");
+			std::cout << (boost::format("  (would take %.1f s on the wire)") % wireSeconds).str() << std::endl;
+			benchmarks.run(run.name, 1, [&]() {
+				sSink = sSink + (uint64)backup(run.mode, run.corruptEvery);
+			});
+		}
+	}
+
+	void benchmarkRestore(Benchmarks &benchmarks, std::vector<Synth::PatchData> const &programs) {
+		Matrix1000 matrix1000;
+		const int kBank = 3;
+		const double kEepromWriteMS = 15.0;
+
+		TPatchVector patches;
+		for (int slot = 0; slot < kRestoredPrograms; slot++) {
+			patches.push_back(std::make_shared<Matrix1000Patch>(programs[kBank * kProgramsPerBank + slot], MidiProgramNumber::fromZeroBase(kBank * kProgramsPerBank + slot)));
+		}
+
+		// Restores the bank into an emulator that starts out with other programs, and checks every slot afterwards. Returns the seconds taken
+		// per program, or a negative number if the restore failed or a slot doesn't hold the program restored
+		auto restoreBank = [&](std::string const &name, Matrix1000BankRestore::Options const &options, int &writesDropped, int &verificationsFailed) {
+			Random random(kSeed + 1);
+			std::vector<Synth::PatchData> before;
+			for (size_t i = 0; i < programs.size(); i++) {
+				before.push_back(randomPatchData(random));
+			}
+			Matrix1000Emulator emulator(before, kEepromWriteMS);
+
+			// The replies to the verification requests are handed back right away, from the thread of the restore
+			Matrix1000BankRestore *target = nullptr;
+			Matrix1000BankRestore restore(&matrix1000, [&emulator, &target](std::vector<MidiMessage> const &messages) {
+				emulator.receive(messages);
+				while (emulator.deliverNext([&target](MidiMessage const &message) { target->handleMessage(message); })) {
+				}
+			});
+			target = &restore;
+
+			WaitableEvent finished;
+			Matrix1000BankRestore::Result result = { false, 0, 0, 0.0, 0 };
+			int64 start = Time::getHighResolutionTicks();
+			bool started = restore.start(kBank, patches, options, [&](Matrix1000BankRestore::Result const &restoreResult) {
+				result = restoreResult;
+				finished.signal();
+			});
+			benchmarks.check(started && finished.wait(120000), name + " finishes");
+			double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+			bool written = result.success;
+			for (int slot = 0; written && slot < kRestoredPrograms; slot++) {
+				written = emulator.program(kBank * kProgramsPerBank + slot) == programs[kBank * kProgramsPerBank + slot];
+			}
+			benchmarks.check(written, name + " writes all programs");
+			writesDropped = emulator.writesDropped();
+			verificationsFailed = result.verificationsFailed;
+			std::cout << (boost::format("  (%d programs, %d writes dropped, %d verifications failed, final gap %d ms)")
+				% result.programsWritten % writesDropped % verificationsFailed % result.finalGapMS).str() << std::endl;
+			return written ? seconds / kRestoredPrograms : -1.0;
+		};
+
+		// With the default gaps the pacing stays above the emulated EEPROM time, so the run does the same every time
+		const std::string name = "bank restore, adaptive pacing, per program";
+		if (benchmarks.wanted(name)) {
+			Matrix1000BankRestore::Options options;
+			options.replyTimeoutMS = 500;
+			int writesDropped, verificationsFailed;
+			double seconds = restoreBank(name, options, writesDropped, verificationsFailed);
+			if (seconds >= 0.0) {
+				benchmarks.report(name, seconds * 1e9);
+			}
+		}
+
+		// This one starts close to the EEPROM time and shrinks the gap quickly, so writes get dropped and the restore has to back off and
+		// write again. Which probes catch the drops is random, so only the result is checked and there is no timing to compare
+		const std::string dropping = "bank restore, pacing into dropped writes";
+		if (benchmarks.wanted(dropping)) {
+			Matrix1000BankRestore::Options options;
+			options.replyTimeoutMS = 500;
+			options.verifyEvery = 4;
+			options.initialGapMS = (int)kEepromWriteMS + 10;
+			options.gapDecreaseMS = 10;
+			options.minimumGapMS = 0;
+			int writesDropped, verificationsFailed;
+			restoreBank(dropping, options, writesDropped, verificationsFailed);
+			benchmarks.check(writesDropped > 0 && verificationsFailed > 0, dropping + " backs off after dropped writes");
+		}
+	}
+
+	void printInstrumentation() {
+		if (!Matrix1000Instrumentation::isEnabled()) {
+			return;
+		}
+		auto snapshot = Matrix1000Instrumentation::snapshot();
+		std::cout << std::endl << "Instrumentation" << std::endl;
+		for (int c = 0; c < Matrix1000Instrumentation::NUMBER_OF_COUNTERS; c++) {
+			std::cout << (boost::format("  %-32s %16d") % Matrix1000Instrumentation::name((Matrix1000Instrumentation::Counter)c) % snapshot.counters[c]).str() << std::endl;
+		}
+		for (int h = 0; h < Matrix1000Instrumentation::NUMBER_OF_HISTOGRAMS; h++) {
+			auto const &histogram = snapshot.histograms[h];
+			double mean = histogram.count > 0 ? (double)histogram.sumNanoseconds / histogram.count : 0.0;
+			std::cout << (boost::format("  %-32s %16d calls, mean %.1f ns, max %d ns") % Matrix1000Instrumentation::name((Matrix1000Instrumentation::Histogram)h)
+				% histogram.count % mean % histogram.maxNanoseconds).str() << std::endl;
+		}
+	}
+
+}
+
+int main(int argc, char *argv[])
+{
+	std::string filter;
+	std::string saveFile;
+	std::string baselineFile;
+	double tolerancePercent = 20.0;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--filter" && hasValue) {
+			filter = argv[++i];
+		}
+		else if (arg == "--save" && hasValue) {
+			saveFile = argv[++i];
+		}
+		else if (arg == "--baseline" && hasValue) {
+			baselineFile = argv[++i];
+		}
+		else if (arg == "--tolerance" && hasValue) {
+			tolerancePercent = std::atof(argv[++i]);
+		}
+		else {
+			std::cout << "Usage: matrix1000-bench [--filter <text>] [--save <file>] [--baseline <file>] [--tolerance <percent>]" << std::endl;
+			return 1;
+		}
+	}
+
+	BenchmarkLogger logger;
+	Benchmarks benchmarks(filter);
+
+	Random random(kSeed);
+	std::vector<Synth::PatchData> programs;
+	for (int i = 0; i < kNumberOfBanks * kProgramsPerBank; i++) {
+		programs.push_back(randomPatchData(random));
+	}
+
+	benchmarkCodec(benchmarks, programs);
+	benchmarkStreams(benchmarks, programs);
+	benchmarkParameters(benchmarks, programs);
+	benchmarkGlobalSettings(benchmarks);
+	benchmarkBackup(benchmarks, programs);
+	benchmarkRestore(benchmarks, programs);
+	printInstrumentation();
+	std::cout << logger.numberOfMessages() << " messages logged, e.g. for the broken program dumps" << std::endl;
+
+	if (!saveFile.empty()) {
+		benchmarks.save(saveFile);
+	}
+	int regressions = baselineFile.empty() ? 0 : benchmarks.compare(baselineFile, tolerancePercent);
+	if (benchmarks.failures() > 0) {
+		std::cout << benchmarks.failures() << " checks failed" << std::endl;
+		return 1;
+	}
+	return regressions > 0 ? 2 : 0;
+}
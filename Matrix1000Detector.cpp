@@ -0,0 +1,136 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000Detector.h"
+#include "Matrix1000Instrumentation.h"
+
+#include "MidiHelpers.h"
+
+#include <map>
+#include <set>
+
+namespace midikraft {
+
+	const int kMinimumQuietMS = 20; // Below this the jitter of the MIDI drivers dominates
+	const double kQuietTimeFactor = 2.0;
+
+	// How long to wait for more replies after the last one, given the round trip time of the port
+	static int quietTimeMS(double latencyMS)
+	{
+		return std::max(kMinimumQuietMS, (int)(latencyMS * kQuietTimeFactor + 0.5));
+	}
+
+	static std::mutex sLatencyLock;
+	static std::map<std::string, double> sLatencyPerPort;
+
+	Matrix1000Detector::Matrix1000Detector(Matrix1000 *matrix1000) : matrix1000_(matrix1000)
+	{
+	}
+
+	int Matrix1000Detector::learnedLatencyMS(std::string const &outputName, int defaultMS)
+	{
+		std::lock_guard<std::mutex> lock(sLatencyLock);
+		auto found = sLatencyPerPort.find(outputName);
+		if (found == sLatencyPerPort.end()) {
+			return defaultMS;
+		}
+		return quietTimeMS(found->second);
+	}
+
+	void Matrix1000Detector::learnLatency(std::string const &outputName, double latencyMS)
+	{
+		std::lock_guard<std::mutex> lock(sLatencyLock);
+		auto found = sLatencyPerPort.find(outputName);
+		if (found == sLatencyPerPort.end()) {
+			sLatencyPerPort[outputName] = latencyMS;
+		}
+		else {
+			// Smooth a little, a single slow reply (e.g. the unit was busy) should not double the detection time for good
+			found->second = 0.75 * found->second + 0.25 * latencyMS;
+		}
+	}
+
+	Matrix1000Detector::Result Matrix1000Detector::detect(std::string const &inputName, std::string const &outputName, int firstReplyTimeoutMS)
+	{
+		std::mutex replyLock;
+		std::set<int> channelsSeen;
+		double lastReply = 0.0;
+		double firstReply = 0.0;
+		WaitableEvent replyArrived;
+
+		auto handle = MidiController::makeOneHandle();
+		MidiController::instance()->enableMidiInput(inputName);
+		MidiController::instance()->addMessageHandler(handle, [&](MidiInput *source, const MidiMessage &message) {
+			if (source != nullptr && source->getName().toStdString() != inputName) {
+				return;
+			}
+			auto channel = matrix1000_->channelIfValidDeviceResponse(message);
+			if (channel.isValid()) {
+				std::lock_guard<std::mutex> lock(replyLock);
+				double now = Time::getMillisecondCounterHiRes();
+				if (channelsSeen.empty()) {
+					firstReply = now;
+				}
+				lastReply = now;
+				channelsSeen.insert(channel.toZeroBasedInt());
+				replyArrived.signal();
+			}
+		});
+
+		std::vector<MidiMessage> burst;
+		for (int channel = 0; channel < 16; channel++) {
+			auto request = matrix1000_->deviceDetect(channel);
+			std::copy(request.begin(), request.end(), std::back_inserter(burst));
+		}
+		MATRIX1000_COUNT(DEVICE_DETECTS, 1);
+		double sent = Time::getMillisecondCounterHiRes();
+		MidiController::instance()->getMidiOutput(outputName)->sendBlockOfMessagesNow(MidiHelpers::bufferFromMessages(burst));
+
+		// Give the first reply the full timeout, or what we know about the port. After that, only wait while replies keep coming in.
+		// On a port not seen before, the round trip of the first reply tells how long that is
+		const int kNotLearned = -1;
+		int quietMS = learnedLatencyMS(outputName, kNotLearned);
+		bool learned = quietMS != kNotLearned;
+		if (!learned) {
+			quietMS = firstReplyTimeoutMS;
+		}
+		double deadline = sent + std::max(quietMS, firstReplyTimeoutMS);
+		while (true) {
+			double now = Time::getMillisecondCounterHiRes();
+			if (now >= deadline) {
+				break;
+			}
+			replyArrived.wait((int)(deadline - now) + 1);
+			std::lock_guard<std::mutex> lock(replyLock);
+			if (!channelsSeen.empty()) {
+				if (!learned) {
+					quietMS = quietTimeMS(firstReply - sent);
+					learned = true;
+				}
+				deadline = lastReply + quietMS;
+			}
+		}
+		MidiController::instance()->removeMessageHandler(handle);
+
+		Result result;
+		std::lock_guard<std::mutex> lock(replyLock);
+		for (int channel : channelsSeen) {
+			result.channels.push_back(MidiChannel::fromZeroBase(channel));
+			// channelIfValidDeviceResponse() has cached the firmware revision of the reply
+			result.firmware.push_back(matrix1000_->firmware(MidiChannel::fromZeroBase(channel)));
+		}
+		if (channelsSeen.empty()) {
+			result.latencyMS = -1.0;
+		}
+		else {
+			result.latencyMS = firstReply - sent;
+			learnLatency(outputName, result.latencyMS);
+			MATRIX1000_RECORD(DEVICE_DETECT_ROUND_TRIP, result.latencyMS * 1e6);
+		}
+		return result;
+	}
+
+}
@@ -0,0 +1,42 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Matrix1000.h"
+
+#include <mutex>
+
+namespace midikraft {
+
+	// Finds all Matrix 1000 on one MIDI port at once. The channel specific ID requests for all 16 channels are sent as a single burst,
+	// and the detection ends once the replies stop, instead of waiting a fixed time per channel. The reply latency is measured
+	// per output port and used for the quiet time of the next detection on that port, and for Matrix1000::deviceDetectSleepMS().
+	// detect() blocks, so call it from a background thread, not the message thread.
+	class Matrix1000Detector {
+	public:
+		struct Result {
+			std::vector<MidiChannel> channels;
+			std::vector<Matrix1000::FirmwareInfo> firmware; // Of the unit on the channel with the same index
+			double latencyMS; // Until the first reply, or -1 if nothing replied
+		};
+
+		Matrix1000Detector(Matrix1000 *matrix1000);
+
+		Result detect(std::string const &inputName, std::string const &outputName, int firstReplyTimeoutMS = 200);
+
+		// What we learned about the port, or the default if nothing ever replied on it
+		static int learnedLatencyMS(std::string const &outputName, int defaultMS);
+
+	private:
+		static void learnLatency(std::string const &outputName, double latencyMS);
+
+		Matrix1000 *matrix1000_;
+	};
+
+}
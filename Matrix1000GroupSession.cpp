@@ -0,0 +1,191 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000GroupSession.h"
+
+#include "MidiHelpers.h"
+
+#include <set>
+
+namespace midikraft {
+
+	Matrix1000GroupSession::Matrix1000GroupSession(Matrix1000 *matrix1000, std::vector<Unit> const &units) : matrix1000_(matrix1000), units_(units)
+	{
+		std::set<std::string> outputs;
+		for (size_t i = 0; i < units_.size(); i++) {
+			if (!outputs.insert(units_[i].outputName).second) {
+				SimpleLogger::instance()->postMessage("Warning: more than one Matrix 1000 of the group on output " + units_[i].outputName + ", they can't be told apart");
+			}
+			transfers_.push_back(std::make_unique<Matrix1000Transfer>(matrix1000_, units_[i].inputName, units_[i].outputName));
+			restores_.push_back(std::make_unique<Matrix1000BankRestore>(matrix1000_, [this, i](std::vector<MidiMessage> const &messages) {
+				send(i, messages);
+			}));
+			restores_.back()->setProgressHandler([this, i](int programsWritten, int programsTotal, double) {
+				if (onProgress_) {
+					onProgress_(i, programsWritten, programsTotal);
+				}
+			});
+		}
+		MidiController::instance()->addMessageHandler(handler_, [this](MidiInput *source, const MidiMessage &message) {
+			handleMessage(source, message);
+		});
+	}
+
+	Matrix1000GroupSession::~Matrix1000GroupSession()
+	{
+		MidiController::instance()->removeMessageHandler(handler_);
+		cancel();
+		// The transfers stop their threads when destroyed, and a restore running on one of them is waited for. So they go first
+		transfers_.clear();
+		restores_.clear();
+	}
+
+	size_t Matrix1000GroupSession::numberOfUnits() const
+	{
+		return units_.size();
+	}
+
+	Matrix1000GroupSession::Unit const & Matrix1000GroupSession::unit(size_t index) const
+	{
+		return units_.at(index);
+	}
+
+	Matrix1000Transfer & Matrix1000GroupSession::transfer(size_t index)
+	{
+		return *transfers_.at(index);
+	}
+
+	void Matrix1000GroupSession::sendEditBuffer(std::shared_ptr<DataFile> patch)
+	{
+		// The message is the same for all units, so build it only once
+		auto messages = matrix1000_->patchToSysex(patch);
+		for (size_t i = 0; i < units_.size(); i++) {
+			send(i, messages);
+		}
+	}
+
+	std::vector<Matrix1000Transfer::Request<bool>> Matrix1000GroupSession::storeToProgram(std::shared_ptr<DataFile> patch, int programNumber, int timeoutMS)
+	{
+		std::vector<Matrix1000Transfer::Request<bool>> result;
+		for (auto &transfer : transfers_) {
+			result.push_back(transfer->storeToProgram(patch, programNumber, timeoutMS));
+		}
+		return result;
+	}
+
+	std::vector<Matrix1000Transfer::Request<TPatchVector>> Matrix1000GroupSession::backupBank(int bank, int timeoutMS)
+	{
+		std::vector<Matrix1000Transfer::Request<TPatchVector>> result;
+		for (auto &transfer : transfers_) {
+			result.push_back(transfer->backupBank(bank, timeoutMS));
+		}
+		return result;
+	}
+
+	bool Matrix1000GroupSession::restoreBank(int bank, TPatchVector const &patches, Matrix1000BankRestore::Options const &options, TRestoreFinishedHandler onFinished)
+	{
+		{
+			std::lock_guard<std::mutex> lock(restoreLock_);
+			if (restoresRunning_ > 0 || units_.empty()) {
+				return false;
+			}
+			onRestoreFinished_ = onFinished;
+			restoreResults_.assign(units_.size(), { false, 0, 0, 0.0, options.initialGapMS });
+			restoresRunning_ = units_.size();
+		}
+		for (size_t i = 0; i < transfers_.size(); i++) {
+			transfers_[i]->runExclusive([this, i, bank, patches, options](Matrix1000Transfer::TCancelledFunction const &isCancelled) {
+				return restoreUnit(i, bank, patches, options, isCancelled);
+			}, [this, i, options]() {
+				// Cancelled while still queued, counts as a failed unit
+				restoreFinished(i, { false, 0, 0, 0.0, options.initialGapMS });
+			});
+		}
+		return true;
+	}
+
+	bool Matrix1000GroupSession::restoreUnit(size_t unit, int bank, TPatchVector const &patches, Matrix1000BankRestore::Options const &options, Matrix1000Transfer::TCancelledFunction const &isCancelled)
+	{
+		// Shared with the handler, which the restore thread might still be in when we return
+		struct State {
+			Matrix1000BankRestore::Result result;
+			WaitableEvent finished;
+		};
+		auto state = std::make_shared<State>();
+		state->result = { false, 0, 0, 0.0, options.initialGapMS };
+		bool started = restores_[unit]->start(bank, patches, options, [state](Matrix1000BankRestore::Result const &result) {
+			state->result = result;
+			state->finished.signal();
+		});
+		if (started) {
+			// Block the transfer thread of the unit until the restore is through
+			bool cancelled = false;
+			while (!state->finished.wait(100)) {
+				if (!cancelled && isCancelled()) {
+					restores_[unit]->cancel();
+					cancelled = true;
+				}
+			}
+		}
+		restoreFinished(unit, state->result);
+		return state->result.success;
+	}
+
+	void Matrix1000GroupSession::setProgressHandler(TProgressHandler handler)
+	{
+		onProgress_ = handler;
+	}
+
+	bool Matrix1000GroupSession::isRestoring() const
+	{
+		std::lock_guard<std::mutex> lock(restoreLock_);
+		return restoresRunning_ > 0;
+	}
+
+	void Matrix1000GroupSession::cancel()
+	{
+		for (auto &restore : restores_) {
+			restore->cancel();
+		}
+		for (auto &transfer : transfers_) {
+			transfer->cancelAll();
+		}
+	}
+
+	void Matrix1000GroupSession::restoreFinished(size_t unit, Matrix1000BankRestore::Result const &result)
+	{
+		TRestoreFinishedHandler onFinished;
+		std::vector<Matrix1000BankRestore::Result> results;
+		{
+			std::lock_guard<std::mutex> lock(restoreLock_);
+			restoreResults_[unit] = result;
+			if (--restoresRunning_ > 0) {
+				return;
+			}
+			onFinished = onRestoreFinished_;
+			results = restoreResults_;
+		}
+		if (onFinished) {
+			onFinished(results);
+		}
+	}
+
+	void Matrix1000GroupSession::send(size_t unit, std::vector<MidiMessage> const &messages)
+	{
+		MidiController::instance()->getMidiOutput(units_[unit].outputName)->sendBlockOfMessagesNow(MidiHelpers::bufferFromMessages(messages));
+	}
+
+	void Matrix1000GroupSession::handleMessage(MidiInput *source, MidiMessage const &message)
+	{
+		// The restores read back programs for verification, each from its own unit
+		for (size_t i = 0; i < units_.size(); i++) {
+			if (source == nullptr || source->getName().toStdString() == units_[i].inputName) {
+				restores_[i]->handleMessage(message);
+			}
+		}
+	}
+
+}
@@ -0,0 +1,73 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Matrix1000.h"
+#include "Matrix1000BankRestore.h"
+#include "Matrix1000Transfer.h"
+
+namespace midikraft {
+
+	// Drives a rack of Matrix 1000 units, e.g. the ones set up as a group via the "Number of Units" and "Group Mode" global settings,
+	// as one. Edits, program stores and bank restores go out to all units at the same time, each on its own port and thread,
+	// so the whole rack takes as long as one unit. The Matrix sysex carries no device ID, so every unit needs its own output port,
+	// units sharing a port would just receive everything twice.
+	class Matrix1000GroupSession {
+	public:
+		struct Unit {
+			std::string inputName;
+			std::string outputName;
+		};
+
+		typedef std::function<void(size_t unit, int programsWritten, int programsTotal)> TProgressHandler;
+		typedef std::function<void(std::vector<Matrix1000BankRestore::Result> const &results)> TRestoreFinishedHandler; // In unit order
+
+		Matrix1000GroupSession(Matrix1000 *matrix1000, std::vector<Unit> const &units);
+		~Matrix1000GroupSession();
+
+		size_t numberOfUnits() const;
+		Unit const &unit(size_t index) const;
+		Matrix1000Transfer &transfer(size_t index); // For requests to a single unit
+
+		// Sends the patch to the edit buffer of all units right away
+		void sendEditBuffer(std::shared_ptr<DataFile> patch);
+
+		// One request per unit, in unit order
+		std::vector<Matrix1000Transfer::Request<bool>> storeToProgram(std::shared_ptr<DataFile> patch, int programNumber, int timeoutMS = 2000);
+		std::vector<Matrix1000Transfer::Request<TPatchVector>> backupBank(int bank, int timeoutMS = 3000);
+
+		// Restores the same bank on all units in parallel, with the adaptive pacing of Matrix1000BankRestore per unit.
+		// Each unit's restore runs as a request on its transfer queue, so stores and backups of that unit wait until it is done instead of
+		// selecting another bank in the middle of it. The handler is called once, from the thread of the unit finishing last
+		bool restoreBank(int bank, TPatchVector const &patches, Matrix1000BankRestore::Options const &options, TRestoreFinishedHandler onFinished);
+		void setProgressHandler(TProgressHandler handler);
+		bool isRestoring() const;
+
+		void cancel();
+
+	private:
+		void send(size_t unit, std::vector<MidiMessage> const &messages);
+		void handleMessage(MidiInput *source, MidiMessage const &message);
+		bool restoreUnit(size_t unit, int bank, TPatchVector const &patches, Matrix1000BankRestore::Options const &options, Matrix1000Transfer::TCancelledFunction const &isCancelled);
+		void restoreFinished(size_t unit, Matrix1000BankRestore::Result const &result);
+
+		Matrix1000 *matrix1000_;
+		std::vector<Unit> units_;
+		std::vector<std::unique_ptr<Matrix1000Transfer>> transfers_;
+		std::vector<std::unique_ptr<Matrix1000BankRestore>> restores_;
+		MidiController::HandlerHandle handler_ = MidiController::makeOneHandle();
+		TProgressHandler onProgress_;
+
+		mutable std::mutex restoreLock_;
+		std::vector<Matrix1000BankRestore::Result> restoreResults_;
+		size_t restoresRunning_ = 0;
+		TRestoreFinishedHandler onRestoreFinished_;
+	};
+
+}
@@ -0,0 +1,126 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000Instrumentation.h"
+
+#include <atomic>
+
+namespace midikraft {
+
+	struct AtomicHistogram {
+		std::array<std::atomic<uint64>, Matrix1000Instrumentation::kNumberOfBuckets> buckets;
+		std::atomic<uint64> count;
+		std::atomic<uint64> sum;
+		std::atomic<uint64> max;
+	};
+
+	// Zero initialized, as all static storage is
+	static std::array<std::atomic<uint64>, Matrix1000Instrumentation::NUMBER_OF_COUNTERS> sCounters;
+	static std::array<AtomicHistogram, Matrix1000Instrumentation::NUMBER_OF_HISTOGRAMS> sHistograms;
+
+	static const char *kCounterNames[Matrix1000Instrumentation::NUMBER_OF_COUNTERS] = {
+		"Messages classified",
+		"Bytes unescaped",
+		"Bytes escaped",
+		"Checksum failures",
+		"Streams completed",
+		"Global settings sends",
+		"Device detects",
+	};
+
+	static const char *kHistogramNames[Matrix1000Instrumentation::NUMBER_OF_HISTOGRAMS] = {
+		"Unescape time",
+		"Escape time",
+		"Bank stream latency",
+		"Device detect round trip",
+	};
+
+	static int bucketOf(uint64 nanoseconds) {
+		int bucket = 0;
+		while (nanoseconds != 0 && bucket < Matrix1000Instrumentation::kNumberOfBuckets - 1) {
+			nanoseconds >>= 1;
+			bucket++;
+		}
+		return bucket;
+	}
+
+	bool Matrix1000Instrumentation::isEnabled()
+	{
+		return MATRIX1000_INSTRUMENTATION != 0;
+	}
+
+	void Matrix1000Instrumentation::count(Counter counter, uint64 amount)
+	{
+		sCounters[counter].fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	void Matrix1000Instrumentation::record(Histogram histogram, uint64 nanoseconds)
+	{
+		auto &h = sHistograms[histogram];
+		h.buckets[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+		h.count.fetch_add(1, std::memory_order_relaxed);
+		h.sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+		uint64 max = h.max.load(std::memory_order_relaxed);
+		while (nanoseconds > max && !h.max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+		}
+	}
+
+	Matrix1000Instrumentation::Snapshot Matrix1000Instrumentation::snapshot()
+	{
+		// Each value is read atomically, but not all of them at the same instant. Good enough for monitoring
+		Snapshot result;
+		for (int c = 0; c < NUMBER_OF_COUNTERS; c++) {
+			result.counters[c] = sCounters[c].load(std::memory_order_relaxed);
+		}
+		for (int h = 0; h < NUMBER_OF_HISTOGRAMS; h++) {
+			auto &source = sHistograms[h];
+			auto &target = result.histograms[h];
+			for (int b = 0; b < kNumberOfBuckets; b++) {
+				target.buckets[b] = source.buckets[b].load(std::memory_order_relaxed);
+			}
+			target.count = source.count.load(std::memory_order_relaxed);
+			target.sumNanoseconds = source.sum.load(std::memory_order_relaxed);
+			target.maxNanoseconds = source.max.load(std::memory_order_relaxed);
+		}
+		return result;
+	}
+
+	void Matrix1000Instrumentation::reset()
+	{
+		for (auto &counter : sCounters) {
+			counter.store(0, std::memory_order_relaxed);
+		}
+		for (auto &histogram : sHistograms) {
+			for (auto &bucket : histogram.buckets) {
+				bucket.store(0, std::memory_order_relaxed);
+			}
+			histogram.count.store(0, std::memory_order_relaxed);
+			histogram.sum.store(0, std::memory_order_relaxed);
+			histogram.max.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	const char * Matrix1000Instrumentation::name(Counter counter)
+	{
+		return (counter >= 0 && counter < NUMBER_OF_COUNTERS) ? kCounterNames[counter] : "";
+	}
+
+	const char * Matrix1000Instrumentation::name(Histogram histogram)
+	{
+		return (histogram >= 0 && histogram < NUMBER_OF_HISTOGRAMS) ? kHistogramNames[histogram] : "";
+	}
+
+	Matrix1000Instrumentation::ScopedTimer::ScopedTimer(Histogram histogram) : histogram_(histogram), start_(Time::getHighResolutionTicks())
+	{
+	}
+
+	Matrix1000Instrumentation::ScopedTimer::~ScopedTimer()
+	{
+		double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start_);
+		record(histogram_, (uint64)(seconds * 1e9));
+	}
+
+}
@@ -0,0 +1,89 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <array>
+
+// Turn on with the CMake option MATRIX1000_INSTRUMENTATION. When off, the macros below expand to nothing and the snapshot stays all zero
+#ifndef MATRIX1000_INSTRUMENTATION
+#define MATRIX1000_INSTRUMENTATION 0
+#endif
+
+namespace midikraft {
+
+	// Process wide counters and latency histograms for the hot paths of the Matrix 1000 adapter. Updates are relaxed atomics,
+	// so they can be done from any thread, and the host polls snapshot() whenever it wants to show or log them.
+	class Matrix1000Instrumentation {
+	public:
+		enum Counter {
+			MESSAGES_CLASSIFIED,
+			BYTES_UNESCAPED, // Counting the escaped sysex bytes fed in
+			BYTES_ESCAPED, // Counting the patch or master data bytes fed in
+			CHECKSUM_FAILURES,
+			STREAMS_COMPLETED,
+			GLOBAL_SETTINGS_SENDS,
+			DEVICE_DETECTS,
+			NUMBER_OF_COUNTERS
+		};
+
+		enum Histogram {
+			UNESCAPE_TIME,
+			ESCAPE_TIME,
+			BANK_STREAM_LATENCY, // From the first message of a bank dump until it is complete
+			DEVICE_DETECT_ROUND_TRIP, // From sending the detect burst until the first reply
+			NUMBER_OF_HISTOGRAMS
+		};
+
+		// Bucket 0 counts values of 0, bucket n values from 2^(n-1) to 2^n - 1 nanoseconds, the last one everything above (about 39 hours)
+		static const int kNumberOfBuckets = 48;
+
+		struct HistogramSnapshot {
+			std::array<uint64, kNumberOfBuckets> buckets;
+			uint64 count;
+			uint64 sumNanoseconds;
+			uint64 maxNanoseconds;
+		};
+
+		struct Snapshot {
+			std::array<uint64, NUMBER_OF_COUNTERS> counters;
+			std::array<HistogramSnapshot, NUMBER_OF_HISTOGRAMS> histograms;
+		};
+
+		static bool isEnabled();
+		static void count(Counter counter, uint64 amount);
+		static void record(Histogram histogram, uint64 nanoseconds);
+		static Snapshot snapshot();
+		static void reset();
+
+		static const char *name(Counter counter);
+		static const char *name(Histogram histogram);
+
+		// Records the lifetime of the object into the histogram
+		class ScopedTimer {
+		public:
+			explicit ScopedTimer(Histogram histogram);
+			~ScopedTimer();
+
+		private:
+			Histogram histogram_;
+			int64 start_;
+		};
+	};
+
+}
+
+#if MATRIX1000_INSTRUMENTATION
+#define MATRIX1000_COUNT(counter, amount) ::midikraft::Matrix1000Instrumentation::count(::midikraft::Matrix1000Instrumentation::counter, (uint64)(amount))
+#define MATRIX1000_RECORD(histogram, nanoseconds) ::midikraft::Matrix1000Instrumentation::record(::midikraft::Matrix1000Instrumentation::histogram, (uint64)(nanoseconds))
+#define MATRIX1000_TIME_SCOPE(histogram) ::midikraft::Matrix1000Instrumentation::ScopedTimer matrix1000ScopedTimer(::midikraft::Matrix1000Instrumentation::histogram)
+#else
+#define MATRIX1000_COUNT(counter, amount) do {} while (false)
+#define MATRIX1000_RECORD(histogram, nanoseconds) do {} while (false)
+#define MATRIX1000_TIME_SCOPE(histogram) do {} while (false)
+#endif
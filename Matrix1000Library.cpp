@@ -0,0 +1,113 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000Library.h"
+
+#include "Matrix1000.h"
+
+namespace midikraft {
+
+	Matrix1000Library::Matrix1000Library(size_t expectedNumberOfPatches)
+	{
+		reserve(expectedNumberOfPatches);
+	}
+
+	size_t Matrix1000Library::size() const
+	{
+		return places_.size();
+	}
+
+	bool Matrix1000Library::empty() const
+	{
+		return places_.empty();
+	}
+
+	void Matrix1000Library::clear()
+	{
+		data_.clear();
+		places_.clear();
+	}
+
+	void Matrix1000Library::reserve(size_t numberOfPatches)
+	{
+		data_.reserve(numberOfPatches * kMatrix1000PatchDataSize);
+		places_.reserve(numberOfPatches);
+	}
+
+	bool Matrix1000Library::add(DataFile const &patch, MidiProgramNumber place)
+	{
+		if (patch.data().size() != kMatrix1000PatchDataSize) {
+			return false;
+		}
+		return add(patch.data().data(), place);
+	}
+
+	bool Matrix1000Library::add(const uint8 *patchData, MidiProgramNumber place)
+	{
+		data_.insert(data_.end(), patchData, patchData + kMatrix1000PatchDataSize);
+		places_.push_back(place);
+		return true;
+	}
+
+	bool Matrix1000Library::addFromSysex(MidiMessage const &message)
+	{
+		auto classification = Matrix1000::classify(message);
+		if (classification.type != Matrix1000::PROGRAM_DUMP && classification.type != Matrix1000::EDIT_BUFFER_WRITE) {
+			return false;
+		}
+
+		// Unescape right into the block, and take it back if the message was broken
+		size_t offset = data_.size();
+		data_.resize(offset + kMatrix1000PatchDataSize);
+		int decoded = Matrix1000::unescapeSysex(&message.getSysExData()[4], message.getSysExDataSize() - 4, &data_[offset], kMatrix1000PatchDataSize);
+		if (decoded != kMatrix1000PatchDataSize) {
+			data_.resize(offset);
+			return false;
+		}
+		places_.push_back(MidiProgramNumber::fromZeroBase(classification.number));
+		return true;
+	}
+
+	size_t Matrix1000Library::addFromStream(std::vector<MidiMessage> const &messages)
+	{
+		size_t added = 0;
+		for (auto const &message : messages) {
+			if (addFromSysex(message)) {
+				added++;
+			}
+		}
+		return added;
+	}
+
+	const uint8 * Matrix1000Library::patchData(size_t index) const
+	{
+		jassert(index < size());
+		return &data_[index * kMatrix1000PatchDataSize];
+	}
+
+	MidiProgramNumber Matrix1000Library::place(size_t index) const
+	{
+		jassert(index < size());
+		return places_[index];
+	}
+
+	std::shared_ptr<Matrix1000Patch> Matrix1000Library::patch(size_t index) const
+	{
+		auto start = patchData(index);
+		return std::make_shared<Matrix1000Patch>(Synth::PatchData(start, start + kMatrix1000PatchDataSize), places_[index]);
+	}
+
+	TPatchVector Matrix1000Library::patches() const
+	{
+		TPatchVector result;
+		result.reserve(size());
+		for (size_t i = 0; i < size(); i++) {
+			result.push_back(patch(i));
+		}
+		return result;
+	}
+
+}
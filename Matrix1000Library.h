@@ -0,0 +1,50 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Matrix1000Patch.h"
+
+namespace midikraft {
+
+	// Stores any number of Matrix 1000 patches in one contiguous block with a stride of 134 bytes, instead of one heap object
+	// plus one data vector per patch. Scans, duplicate detection and diffing work on the raw bytes, and Matrix1000Patch objects
+	// are only created for the slots actually handed out.
+	class Matrix1000Library {
+	public:
+		Matrix1000Library() = default;
+		explicit Matrix1000Library(size_t expectedNumberOfPatches);
+
+		size_t size() const;
+		bool empty() const;
+		void clear();
+		void reserve(size_t numberOfPatches);
+
+		// Copies the patch data into the library. Data not exactly 134 bytes long is rejected
+		bool add(DataFile const &patch, MidiProgramNumber place);
+		bool add(const uint8 *patchData, MidiProgramNumber place);
+
+		// Decodes a program dump or single patch to edit buffer message straight into the library, returns false for
+		// any other message or if the checksum doesn't match
+		bool addFromSysex(MidiMessage const &message);
+		size_t addFromStream(std::vector<MidiMessage> const &messages);
+
+		// Raw view onto the 134 bytes of a patch, valid until the library is modified
+		const uint8 *patchData(size_t index) const;
+		MidiProgramNumber place(size_t index) const;
+
+		// Materializes a patch with a copy of the data, e.g. for handing it to the DataFile based parts of the host
+		std::shared_ptr<Matrix1000Patch> patch(size_t index) const;
+		TPatchVector patches() const;
+
+	private:
+		std::vector<uint8> data_;
+		std::vector<MidiProgramNumber> places_;
+	};
+
+}
@@ -0,0 +1,195 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000LibraryFile.h"
+
+#include "Matrix1000.h"
+#include "Matrix1000Library.h"
+
+#include "SimpleLogger.h"
+
+namespace midikraft {
+
+	const char kLibraryMagic[8] = { 'M', 'T', 'X', '1', 'K', 'L', 'I', 'B' };
+	const uint32 kLibraryVersion = 1;
+	const int kHeaderSize = 32;
+	const int kIndexEntrySize = 20;
+	const int kNameLength = 8;
+
+	bool Matrix1000LibraryFile::write(File const &file, Matrix1000Library const &library)
+	{
+		auto out = file.createOutputStream();
+		if (!out || !out->openedOk()) {
+			SimpleLogger::instance()->postMessage("Could not open " + file.getFullPathName() + " for writing");
+			return false;
+		}
+		// An existing file would be appended to
+		bool ok = out->setPosition(0) && out->truncate().wasOk();
+
+		uint32 numberOfPatches = (uint32)library.size();
+		uint32 indexOffset = kHeaderSize + numberOfPatches * kMatrix1000PatchDataSize;
+		ok = ok && out->write(kLibraryMagic, sizeof(kLibraryMagic));
+		ok = ok && out->writeInt((int)kLibraryVersion);
+		ok = ok && out->writeInt((int)numberOfPatches);
+		ok = ok && out->writeInt(kHeaderSize);
+		ok = ok && out->writeInt((int)indexOffset);
+		ok = ok && out->writeInt64(0);
+
+		for (size_t i = 0; ok && i < library.size(); i++) {
+			ok = out->write(library.patchData(i), kMatrix1000PatchDataSize);
+		}
+
+		for (size_t i = 0; ok && i < library.size(); i++) {
+			auto data = library.patchData(i);
+			ok = out->writeInt64((int64)Matrix1000::voiceFingerprint(data, kMatrix1000PatchDataSize));
+			ok = ok && out->writeShort((short)library.place(i).toZeroBased());
+			// Same decoding as Matrix1000Patch::name(), so listing a library needs no patch objects
+			char name[kNameLength];
+			for (int c = 0; c < kNameLength; c++) {
+				name[c] = (char)(data[c] < 32 ? data[c] + 'A' - 1 : data[c]);
+			}
+			ok = ok && out->write(name, sizeof(name));
+			ok = ok && out->writeShort(0);
+		}
+		if (ok) {
+			// Buffered bytes only hit the disk here, so a full disk might only show now
+			out->flush();
+			ok = out->getStatus().wasOk();
+		}
+		if (!ok) {
+			// Don't leave a truncated library behind that open() might accept
+			out.reset();
+			file.deleteFile();
+			SimpleLogger::instance()->postMessage("Could not write " + file.getFullPathName() + ", disk full?");
+			return false;
+		}
+		return true;
+	}
+
+	bool Matrix1000LibraryFile::open(File const &file)
+	{
+		close();
+		if (!file.existsAsFile()) {
+			return false;
+		}
+		auto map = std::make_unique<MemoryMappedFile>(file, MemoryMappedFile::readOnly);
+		auto base = static_cast<const uint8 *>(map->getData());
+		size_t mappedSize = map->getSize();
+		if (base == nullptr || mappedSize < kHeaderSize || memcmp(base, kLibraryMagic, sizeof(kLibraryMagic)) != 0) {
+			SimpleLogger::instance()->postMessage(file.getFullPathName() + " is not a Matrix 1000 library file");
+			return false;
+		}
+		uint32 version = ByteOrder::littleEndianInt(base + 8);
+		if (version > kLibraryVersion) {
+			SimpleLogger::instance()->postMessage(file.getFullPathName() + " was written by a newer version, can't read it");
+			return false;
+		}
+		if (version != kLibraryVersion) {
+			SimpleLogger::instance()->postMessage(file.getFullPathName() + " has the unsupported version " + String(version) + ", it is probably corrupt");
+			return false;
+		}
+
+		size_t numberOfPatches = ByteOrder::littleEndianInt(base + 12);
+		size_t patchOffset = ByteOrder::littleEndianInt(base + 16);
+		size_t indexOffset = ByteOrder::littleEndianInt(base + 20);
+		if (patchOffset + numberOfPatches * kMatrix1000PatchDataSize > mappedSize || indexOffset + numberOfPatches * kIndexEntrySize > mappedSize) {
+			SimpleLogger::instance()->postMessage(file.getFullPathName() + " is truncated, can't read it");
+			return false;
+		}
+
+		size_ = numberOfPatches;
+		patches_ = base + patchOffset;
+		index_ = base + indexOffset;
+		map_ = std::move(map);
+		return true;
+	}
+
+	void Matrix1000LibraryFile::close()
+	{
+		size_ = 0;
+		patches_ = nullptr;
+		index_ = nullptr;
+		map_.reset();
+	}
+
+	bool Matrix1000LibraryFile::isOpen() const
+	{
+		return map_ != nullptr;
+	}
+
+	size_t Matrix1000LibraryFile::size() const
+	{
+		return size_;
+	}
+
+	const uint8 * Matrix1000LibraryFile::patchData(size_t index) const
+	{
+		jassert(index < size_);
+		return patches_ + index * kMatrix1000PatchDataSize;
+	}
+
+	const uint8 * Matrix1000LibraryFile::indexEntry(size_t index) const
+	{
+		jassert(index < size_);
+		return index_ + index * kIndexEntrySize;
+	}
+
+	MidiProgramNumber Matrix1000LibraryFile::place(size_t index) const
+	{
+		return MidiProgramNumber::fromZeroBase(ByteOrder::littleEndianShort(indexEntry(index) + 8));
+	}
+
+	uint64 Matrix1000LibraryFile::fingerprint(size_t index) const
+	{
+		return ByteOrder::littleEndianInt64(indexEntry(index));
+	}
+
+	std::string Matrix1000LibraryFile::name(size_t index) const
+	{
+		return std::string(reinterpret_cast<const char *>(indexEntry(index) + 10), kNameLength);
+	}
+
+	std::vector<size_t> Matrix1000LibraryFile::findByFingerprint(uint64 fingerprint) const
+	{
+		std::vector<size_t> result;
+		for (size_t i = 0; i < size_; i++) {
+			if (ByteOrder::littleEndianInt64(index_ + i * kIndexEntrySize) == fingerprint) {
+				result.push_back(i);
+			}
+		}
+		return result;
+	}
+
+	std::shared_ptr<Matrix1000Patch> Matrix1000LibraryFile::patch(size_t index) const
+	{
+		auto data = patchData(index);
+		return std::make_shared<Matrix1000Patch>(Synth::PatchData(data, data + kMatrix1000PatchDataSize), place(index));
+	}
+
+	bool Matrix1000LibraryFile::exportSysex(OutputStream &out, bool asEditBuffer) const
+	{
+		// F0 10 06, command and number, the nibbles and the checksum, F7
+		std::array<uint8, 5 + 2 * kMatrix1000PatchDataSize + 1 + 1> frame;
+		frame[0] = 0xf0;
+		frame[1] = 0x10; // Oberheim
+		frame[2] = 0x06; // Matrix 6/1000
+		frame[3] = asEditBuffer ? 0x0d /* Single patch to edit buffer */ : 0x01 /* Single patch data */;
+		for (size_t i = 0; i < size_; i++) {
+			frame[4] = asEditBuffer ? 0x00 : (uint8)(place(i).toZeroBased() % 100);
+			int written = Matrix1000::escapeSysex(patchData(i), kMatrix1000PatchDataSize, &frame[5], (int)frame.size() - 6);
+			if (written < 0) {
+				jassert(false);
+				return false;
+			}
+			frame[5 + written] = 0xf7;
+			if (!out.write(frame.data(), (size_t)(5 + written + 1))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,60 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Matrix1000Patch.h"
+
+namespace midikraft {
+
+	class Matrix1000Library;
+
+	// Native file format for large Matrix 1000 collections, read through a memory map so opening is instant regardless of size.
+	// Layout, all numbers little endian:
+	//   header, 32 bytes: "MTX1KLIB", version, number of patches, offset of the patch array, offset of the index, 8 bytes reserved
+	//   patch array: the raw 134 bytes of each patch, no gaps
+	//   index, 20 bytes per patch: voice fingerprint (8), program number 0-999 (2), name as displayed (8), reserved (2)
+	class Matrix1000LibraryFile {
+	public:
+		Matrix1000LibraryFile() = default;
+
+		static bool write(File const &file, Matrix1000Library const &library);
+
+		// Maps the file. Returns false if it is missing, not a library file or truncated
+		bool open(File const &file);
+		void close();
+		bool isOpen() const;
+
+		size_t size() const;
+
+		// Views into the map, valid until close()
+		const uint8 *patchData(size_t index) const;
+		MidiProgramNumber place(size_t index) const;
+		uint64 fingerprint(size_t index) const;
+		std::string name(size_t index) const;
+
+		// Scans the index only, the patch data is not touched
+		std::vector<size_t> findByFingerprint(uint64 fingerprint) const;
+
+		// Creates a patch object with a copy of the data for this one slot
+		std::shared_ptr<Matrix1000Patch> patch(size_t index) const;
+
+		// Writes all patches as program dumps (as patchToProgramDumpSysex() would) or as edit buffer dumps (as patchToSysex() would),
+		// escaping directly from the map into the stream
+		bool exportSysex(OutputStream &out, bool asEditBuffer = false) const;
+
+	private:
+		const uint8 *indexEntry(size_t index) const;
+
+		std::unique_ptr<MemoryMappedFile> map_;
+		size_t size_ = 0;
+		const uint8 *patches_ = nullptr;
+		const uint8 *index_ = nullptr;
+	};
+
+}
@@ -0,0 +1,192 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000LiveEditor.h"
+
+namespace midikraft {
+
+	// Targets 0..127 are the controller numbers of the remote parameter edit, followed by the modulation buses and the two CCs
+	const int kModulationBusTarget = 128;
+	const int kNumberOfModulationBuses = 10;
+	const int kVolumeTarget = kModulationBusTarget + kNumberOfModulationBuses;
+	const int kUnisonDetuneTarget = kVolumeTarget + 1;
+	const int kNumberOfTargets = kUnisonDetuneTarget + 1;
+
+	const int kFirstModulationBusIndex = 104; // Sysex index of the source of bus 0, followed by amount and destination
+
+	// Bytes on the wire
+	const int kRemoteParameterEditSize = 7; // F0 10 06 06 pp vv F7
+	const int kModulationBusEditSize = 8; // F0 10 06 0b bus source amount destination F7
+	const int kNRPNSize = 9; // Three controller messages, NRPN MSB and LSB and the data entry
+	const int kControllerSize = 3;
+
+	Matrix1000LiveEditor::Matrix1000LiveEditor(Matrix1000 *matrix1000, TSendFunction send, int tickMS) :
+		matrix1000_(matrix1000), send_(send), tickMS_(tickMS), nrpnSupported_(false), preferNRPN_(false), unisonDetuneSupported_(true), volume_(127), unisonDetune_(0),
+		lastParam_(kNumberOfTargets, nullptr), pending_(kNumberOfTargets, false)
+	{
+		setFirmware(matrix1000_->firmware());
+		shadow_ = std::make_unique<Matrix1000Patch>(Synth::PatchData(kMatrix1000PatchDataSize, 0), MidiProgramNumber::fromZeroBase(0));
+	}
+
+	Matrix1000LiveEditor::~Matrix1000LiveEditor()
+	{
+		stopTimer();
+	}
+
+	void Matrix1000LiveEditor::setEditBuffer(Synth::PatchData const &patchData)
+	{
+		if (patchData.size() != kMatrix1000PatchDataSize) {
+			jassertfalse;
+			return;
+		}
+		// Whatever is still pending refers to the old patch
+		std::fill(pending_.begin(), pending_.end(), false);
+		pendingOrder_.clear();
+		shadow_ = std::make_unique<Matrix1000Patch>(patchData, MidiProgramNumber::fromZeroBase(0));
+	}
+
+	Matrix1000Patch const & Matrix1000LiveEditor::editBuffer() const
+	{
+		return *shadow_;
+	}
+
+	void Matrix1000LiveEditor::setNRPNSupported(bool supported)
+	{
+		nrpnSupported_ = supported;
+	}
+
+	void Matrix1000LiveEditor::setPreferNRPN(bool preferNRPN)
+	{
+		preferNRPN_ = preferNRPN;
+	}
+
+	void Matrix1000LiveEditor::setFirmware(Matrix1000::FirmwareInfo const &firmware)
+	{
+		nrpnSupported_ = firmware.supportsNRPN();
+		// Not knowing the firmware, we send the controller anyway. Older firmware just ignores it
+		unisonDetuneSupported_ = !firmware.isKnown() || firmware.supportsUnisonDetune();
+	}
+
+	int Matrix1000LiveEditor::targetOf(Matrix1000Param id) const
+	{
+		switch (id) {
+		case Volume: return kVolumeTarget;
+		case GliGliDetune: return kUnisonDetuneTarget;
+		default:
+			break;
+		}
+		auto const &param = Matrix1000ParamDefinition::definition(id);
+		if (param.controller() >= 0) {
+			// Bit field parameters share the controller and therefore the target, the message carries the whole byte
+			return param.controller();
+		}
+		// Only the modulation buses have no controller
+		jassert(param.sysexIndex() >= kFirstModulationBusIndex);
+		return kModulationBusTarget + (param.sysexIndex() - kFirstModulationBusIndex) / 3;
+	}
+
+	bool Matrix1000LiveEditor::useNRPN(Matrix1000ParamDefinition const &param) const
+	{
+		// The single parameter sysex is always the smaller message (7 bytes against 9 for the NRPN), so NRPN is only used when asked for
+		return nrpnSupported_ && param.controller() >= 0 && preferNRPN_;
+	}
+
+	int Matrix1000LiveEditor::messageSize(Matrix1000Param id) const
+	{
+		int target = targetOf(id);
+		if (target == kVolumeTarget || target == kUnisonDetuneTarget) {
+			return kControllerSize;
+		}
+		if (target >= kModulationBusTarget) {
+			return kModulationBusEditSize;
+		}
+		return useNRPN(Matrix1000ParamDefinition::definition(id)) ? kNRPNSize : kRemoteParameterEditSize;
+	}
+
+	void Matrix1000LiveEditor::setParameter(Matrix1000Param id, int value)
+	{
+		int target = targetOf(id);
+		if (target == kVolumeTarget) {
+			volume_ = value;
+		}
+		else if (target == kUnisonDetuneTarget) {
+			unisonDetune_ = value;
+			if (!unisonDetuneSupported_) {
+				return;
+			}
+		}
+		else {
+			auto const &param = Matrix1000ParamDefinition::definition(id);
+			param.setInPatch(*shadow_, value);
+			lastParam_[target] = &param;
+		}
+
+		if (!pending_[target]) {
+			pending_[target] = true;
+			pendingOrder_.push_back(target);
+		}
+
+		if (!isTimerRunning()) {
+			// Nothing was sent during the last tick, so there is no need to wait
+			flush();
+			startTimer(tickMS_);
+		}
+	}
+
+	void Matrix1000LiveEditor::appendMessages(int target, std::vector<MidiMessage> &out) const
+	{
+		int channel = matrix1000_->channel().toOneBasedInt();
+		if (target == kVolumeTarget) {
+			out.push_back(MidiMessage::controllerEvent(channel, 0x07, volume_));
+		}
+		else if (target == kUnisonDetuneTarget) {
+			out.push_back(MidiMessage::controllerEvent(channel, 0x5e, unisonDetune_)); // Firmware 1.16 and 1.20 only
+		}
+		else if (target >= kModulationBusTarget) {
+			int bus = target - kModulationBusTarget;
+			int index = kFirstModulationBusIndex + 3 * bus;
+			out.push_back(matrix1000_->createModulationBusEdit(bus, shadow_->at(index), shadow_->at(index + 1), shadow_->at(index + 2)));
+		}
+		else {
+			auto param = lastParam_[target];
+			jassert(param != nullptr);
+			int byte = shadow_->at(param->sysexIndex());
+			if (useNRPN(*param)) {
+				int value = (param->bitposition() == -1 && param->bits() < 0) ? (int)(int8)byte : byte;
+				auto nrpn = matrix1000_->createParameterNRPN(*param, value);
+				std::copy(nrpn.begin(), nrpn.end(), std::back_inserter(out));
+			}
+			else {
+				out.push_back(matrix1000_->createRemoteParameterEdit(target, byte));
+			}
+		}
+	}
+
+	void Matrix1000LiveEditor::flush()
+	{
+		if (pendingOrder_.empty()) {
+			return;
+		}
+		std::vector<MidiMessage> messages;
+		for (int target : pendingOrder_) {
+			appendMessages(target, messages);
+			pending_[target] = false;
+		}
+		pendingOrder_.clear();
+		send_(messages);
+	}
+
+	void Matrix1000LiveEditor::timerCallback()
+	{
+		if (pendingOrder_.empty()) {
+			// A quiet tick, the next change can be sent right away again
+			stopTimer();
+			return;
+		}
+		flush();
+	}
+
+}
@@ -0,0 +1,69 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Matrix1000.h"
+#include "Matrix1000Patch.h"
+
+namespace midikraft {
+
+	// Output stage for live editing the edit buffer of the Matrix 1000. Each change is sent as the cheapest single value message
+	// that can carry it instead of a full edit buffer dump. The first change goes out immediately, further changes
+	// within one tick are collapsed to the last value per target (a controller, a modulation bus, or a CC), so knob sweeps
+	// produce at most one message per target and tick. Use from the message thread only.
+	class Matrix1000LiveEditor : private Timer {
+	public:
+		typedef std::function<void(std::vector<MidiMessage> const &messages)> TSendFunction;
+
+		Matrix1000LiveEditor(Matrix1000 *matrix1000, TSendFunction send, int tickMS = 20);
+		virtual ~Matrix1000LiveEditor() override;
+
+		// The shadow copy of the edit buffer, which is needed to fill in the bit fields and modulation bus values not changed
+		void setEditBuffer(Synth::PatchData const &patchData);
+		Matrix1000Patch const &editBuffer() const;
+
+		// Firmware 1.16 and 1.20 also accept NRPN. It is only used when supported and preferred, e.g. because something in the MIDI chain
+		// drops sysex, and only for parameters that have an NRPN controller. Otherwise the 7 byte sysex is sent, which is always shorter
+		void setNRPNSupported(bool supported);
+		void setPreferNRPN(bool preferNRPN);
+
+		// Sets what the unit supports from the firmware detected, initially taken from Matrix1000::firmware().
+		// With a firmware known to lack it, unison detune changes are dropped
+		void setFirmware(Matrix1000::FirmwareInfo const &firmware);
+
+		// Value as returned by Matrix1000Patch::param(), i.e. signed for the signed parameters and 0 or 1 for the bit fields
+		void setParameter(Matrix1000Param id, int value);
+		void flush();
+
+		// Bytes the MIDI link needs to carry a change of this parameter with the current options
+		int messageSize(Matrix1000Param id) const;
+
+	private:
+		void timerCallback() override;
+		int targetOf(Matrix1000Param id) const;
+		bool useNRPN(Matrix1000ParamDefinition const &param) const;
+		void appendMessages(int target, std::vector<MidiMessage> &out) const;
+
+		Matrix1000 *matrix1000_;
+		TSendFunction send_;
+		int tickMS_;
+		bool nrpnSupported_;
+		bool preferNRPN_;
+		bool unisonDetuneSupported_;
+
+		std::unique_ptr<Matrix1000Patch> shadow_;
+		int volume_;
+		int unisonDetune_;
+
+		std::vector<Matrix1000ParamDefinition const *> lastParam_; // Per target, to know how to send a controller target
+		std::vector<bool> pending_;
+		std::vector<int> pendingOrder_;
+	};
+
+}
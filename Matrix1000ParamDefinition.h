@@ -10,10 +10,55 @@
 #include "Synth.h"
 #include "Patch.h"
 
+#include <array>
+#include <bitset>
+
 namespace midikraft {
 
-	typedef std::function<bool(DataFile const &data)> TActivePredicate;
-	typedef std::map<int, std::string> TValueLookup;
+	class Matrix1000Patch;
+
+	// Describes when a parameter has an effect on the sound, as data so it can be evaluated directly on the patch bytes.
+	// BITS_SET needs every term to have any of its mask bits set in the byte at its index, MODULATION_SOURCE_USED needs
+	// the source code given to be selected on any of the modulation buses
+	struct Matrix1000ActiveCondition {
+		enum Kind { ALWAYS, BITS_SET, MODULATION_SOURCE_USED };
+		struct Term {
+			int sysexIndex;
+			uint8 mask;
+		};
+
+		Kind kind;
+		int numberOfTerms;
+		Term terms[2];
+		int modulationSource;
+
+		static constexpr Matrix1000ActiveCondition always() { return { ALWAYS, 0, { { -1, 0 }, { -1, 0 } }, -1 }; }
+		static constexpr Matrix1000ActiveCondition ifBitsSet(int sysexIndex, uint8 mask) { return { BITS_SET, 1, { { sysexIndex, mask }, { -1, 0 } }, -1 }; }
+		static constexpr Matrix1000ActiveCondition ifBitsSet(int sysexIndex1, uint8 mask1, int sysexIndex2, uint8 mask2) { return { BITS_SET, 2, { { sysexIndex1, mask1 }, { sysexIndex2, mask2 } }, -1 }; }
+		static constexpr Matrix1000ActiveCondition ifNonZero(int sysexIndex) { return ifBitsSet(sysexIndex, 0xff); }
+		static constexpr Matrix1000ActiveCondition ifNonZero(int sysexIndex1, int sysexIndex2) { return ifBitsSet(sysexIndex1, 0xff, sysexIndex2, 0xff); }
+		static constexpr Matrix1000ActiveCondition ifModulationSourceUsed(int source) { return { MODULATION_SOURCE_USED, 0, { { -1, 0 }, { -1, 0 } }, source }; }
+
+		// modulationSourcesUsed has bit n set if source code n is selected on any bus, see modulationSourcesUsed()
+		bool isMet(const uint8 *data, size_t size, uint32 modulationSourcesUsed) const;
+		static uint32 modulationSourcesUsed(const uint8 *data, size_t size);
+	};
+
+	// The value to text tables some of the parameters use
+	enum Matrix1000ValueLookup {
+		NO_LOOKUP,
+		KEYBOARD_MODE_LOOKUP,
+		SYNC_MODE_LOOKUP,
+		LAG_MODE_LOOKUP,
+		LFO_TRIGGER_LOOKUP,
+		LFO_WAVE_LOOKUP,
+		RAMP_MODE_LOOKUP,
+		MODULATION_SOURCE_LOOKUP,
+		MODULATION_DESTINATION_LOOKUP,
+		NUMBER_OF_LOOKUPS
+	};
+
+	const int kMatrix1000PatchDataSize = 134; // Number of bytes of an unescaped single patch
 
 	enum Matrix1000Param {
 		Keyboard_mode,
@@ -169,41 +214,31 @@ namespace midikraft {
 		LAST
 	};
 
-	class Matrix1000ParamDefinition : public SynthParameterDefinition, public SynthIntParameterCapability, public SynthParameterActiveDetectionCapability {
-	public:
-		static std::vector<std::shared_ptr<SynthParameterDefinition>> allDefinitions;
+	const int kMatrix1000NumberOfSysexParams = Volume; // All parameters before Volume are stored in the patch
 
-		Matrix1000ParamDefinition(Matrix1000Param id, int sysExIndex, int paramValue, int bits, std::string const &description) :
-			paramId_(id), sysexIndex_(sysExIndex), controller_(paramValue), bits_(bits), bitposition_(-1), description_(description), activeIfNonNull_(false) {
-		}
-
-		Matrix1000ParamDefinition(Matrix1000Param id, int sysExIndex, int paramValue, int bits, std::string const &description, TActivePredicate predicate) :
-			paramId_(id), sysexIndex_(sysExIndex), controller_(paramValue), bits_(bits), bitposition_(-1), description_(description), activeIfNonNull_(false), testActive_(predicate) {
-		}
-
-		Matrix1000ParamDefinition(Matrix1000Param id, int sysExIndex, int paramValue, int bits, int bitposition, std::string const &description, bool activeIfNonNull = false) :
-			paramId_(id), sysexIndex_(sysExIndex), controller_(paramValue), bits_(bits), bitposition_(bitposition), description_(description), activeIfNonNull_(activeIfNonNull) {
-		}
-
-		Matrix1000ParamDefinition(Matrix1000Param id, int sysExIndex, int paramValue, int bits, std::string const &description, TValueLookup const &valueLookup) :
-			paramId_(id), sysexIndex_(sysExIndex), controller_(paramValue), bits_(bits), bitposition_(-1), description_(description), lookup_(valueLookup), activeIfNonNull_(false) {
-
-		}
-
-		Matrix1000ParamDefinition(Matrix1000Param id, int sysExIndex, int paramValue, int bits, std::string const &description, TValueLookup const &valueLookup, TActivePredicate predicate) :
-			paramId_(id), sysexIndex_(sysExIndex), controller_(paramValue), bits_(bits), bitposition_(-1), description_(description), lookup_(valueLookup), activeIfNonNull_(false), testActive_(predicate) {
+	// One row of the parameter layout. controller is the number for the remote parameter edit (-1 for the modulation bus parameters,
+	// which are only reachable via the bus edit), bits is negative for signed values, bitposition is -1 unless the parameter is a single bit
+	struct Matrix1000ParamLayout {
+		Matrix1000Param id;
+		int sysexIndex;
+		int controller;
+		int bits;
+		int bitposition;
+		bool activeIfNonNull;
+		Matrix1000ValueLookup lookup;
+		Matrix1000ActiveCondition condition;
+		const char *description;
+	};
 
-		}
+	// Constant initialized table of all parameters stored in the patch, indexed by Matrix1000Param
+	extern const std::array<Matrix1000ParamLayout, kMatrix1000NumberOfSysexParams> kMatrix1000ParamLayout;
 
-		Matrix1000ParamDefinition(Matrix1000Param id, int sysExIndex, int bits, std::string const &description, TActivePredicate predicate) :
-			paramId_(id), sysexIndex_(sysExIndex), controller_(-1), bits_(bits), bitposition_(-1), description_(description), activeIfNonNull_(false), testActive_(predicate) {
-			// There are a few parameters that have no CC controller assigned, and can only be modified with specific sysex messages
-		}
+	class Matrix1000ParamDefinition : public SynthParameterDefinition, public SynthIntParameterCapability, public SynthParameterActiveDetectionCapability {
+	public:
+		// The runtime definitions, created from kMatrix1000ParamLayout on first use
+		static std::vector<std::shared_ptr<SynthParameterDefinition>> const &allDefinitions();
 
-		Matrix1000ParamDefinition(Matrix1000Param id, int sysExIndex, int bits, std::string const &description, TValueLookup const &valueLookup, TActivePredicate predicate) :
-			paramId_(id), sysexIndex_(sysExIndex), controller_(-1), bits_(bits), bitposition_(-1), description_(description), lookup_(valueLookup), activeIfNonNull_(false), testActive_(predicate) {
-			// There are a few parameters that have no CC controller assigned, and can only be modified with specific sysex messages
-		}
+		explicit Matrix1000ParamDefinition(Matrix1000ParamLayout const &layout);
 
 		Matrix1000Param id() const;
 		int controller() const;
@@ -215,6 +250,8 @@ namespace midikraft {
 		
 		virtual std::string description() const override;
 		std::string valueInPatchToText(DataFile const &patch) const override;
+		// Same text, but from tables built up front, so this never allocates. The reference stays valid as long as the definition
+		std::string const &valueInPatchAsText(DataFile const &patch) const;
 
 		// SynthIntParameterCapability
 		
@@ -225,11 +262,30 @@ namespace midikraft {
 		virtual bool valueInPatch(DataFile const &patch, int &outValue) const override;
 
 		virtual bool isActive(DataFile const *patch) const override;
+		// The active state of all parameters in one go, indexed by Matrix1000Param. Volume and GliGliDetune are not in the patch and stay false
+		static std::bitset<LAST> computeActiveMask(DataFile const &patch);
+		static std::bitset<LAST> computeActiveMask(const uint8 *data, size_t size);
+
+		// Decodes a value straight from raw patch bytes, with the same sign extension and bit masking as valueInPatch()
+		static bool valueInData(Matrix1000ParamLayout const &layout, const uint8 *data, size_t size, int &outValue);
+
+		// Bulk decoding of every parameter stored in the patch, for exports and analytics over whole archives. Row n of the result holds the
+		// kMatrix1000NumberOfSysexParams values of patch n in Matrix1000Param order, patches with a wrong data size give a row of zeros.
+		// The raw variant reads patches stored back to back with a stride of 134 bytes, as Matrix1000Library and Matrix1000LibraryFile keep them
+		static void extractAll(const uint8 *patchData, size_t numberOfPatches, int16 *outValues);
+		static void extractAll(std::vector<Matrix1000Patch const *> const &patches, std::vector<int16> &outValues);
+		// Same layout, with the text valueInPatchAsText() would return. The strings are shared tables that live as long as the program
+		static void extractAllAsText(std::vector<Matrix1000Patch const *> const &patches, std::vector<std::string const *> &outTexts);
 
+		// Constant time lookup of the definition of a parameter, throws for IDs not present in the sysex data
 		static SynthParameterDefinition const &param(Matrix1000Param id);
+		static Matrix1000ParamDefinition const &definition(Matrix1000Param id);
+		// All parameters stored in the given byte of the patch data. Bit field parameters share a byte, so there can be more than one
+		static std::vector<Matrix1000ParamDefinition const *> const &definitionsAtSysexIndex(int sysexIndex);
+		static Matrix1000ParamLayout const &layout(Matrix1000Param id) { jassert(id >= 0 && id < kMatrix1000NumberOfSysexParams); return kMatrix1000ParamLayout[id]; }
 
 	private:
-		std::string valueAsText(int value) const;
+		std::string const &valueAsText(int value) const;
 
 		Matrix1000Param paramId_;
 		int sysexIndex_;
@@ -238,8 +294,8 @@ namespace midikraft {
 		int bitposition_;
 		bool activeIfNonNull_;
 		std::string description_;
-		TValueLookup lookup_;
-		TActivePredicate testActive_;
+		std::vector<std::string> const *lookupText_; // Shared dense table indexed by value, empty strings for values not in the lookup
+		Matrix1000ActiveCondition condition_;
 	};
 
 }
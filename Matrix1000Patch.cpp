@@ -14,6 +14,7 @@
 #include <unicode/ucnv.h>
 
 #include <regex>
+#include <algorithm>
 
 namespace midikraft {
 
@@ -23,51 +24,71 @@ namespace midikraft {
 	{
 	}
 
+	const int kMatrix1000NameLength = 8;
+
+	// What the Matrix stores for each 7 bit ASCII character. It only uses 6 bits for the name, so I would think it does uppercase letters only
+	// (6 bits would be up to 2^6 = ascii 64)
+	struct AsciiToMatrixTable {
+		uint8 code[128];
+		constexpr AsciiToMatrixTable() : code() {
+			for (int c = 0; c < 128; c++) {
+				if (c == 0x1a) {
+					// This is the substitution character ucnv_convert creates. We will replace it with something funny
+					code[c] = 0x40 /* @ */;
+				}
+				else if (c > 0x5f) {
+					code[c] = (uint8)(c - 0x20); // This works because it would bring the highest ascii character 7f down to 5f
+				}
+				else if (c < 0x20) {
+					// Any other non-printable ASCII character, use a different substitution character, like "_"
+					code[c] = 0x5f;
+				}
+				else {
+					// Valid ASCII
+					code[c] = (uint8)c;
+				}
+			}
+		}
+	};
+	constexpr AsciiToMatrixTable kAsciiToMatrix;
+
 	std::string Matrix1000Patch::name() const
 	{
-		// The patch name are the first 8 bytes ASCII
-		std::string name;
-		for (int i = 0; i < 8; i++) {
-			int charValue = at(i);
+		// The patch name are the first 8 bytes ASCII. Eight characters fit into the small string buffer, so this does not allocate
+		char name[kMatrix1000NameLength];
+		auto const &patchData = data();
+		for (int i = 0; i < kMatrix1000NameLength; i++) {
+			int charValue = i < (int)patchData.size() ? patchData[i] : 0x20;
 			if (charValue < 32) {
 				//WTF? I found old factory banks that had the letters literally as the "Number of the letter in the Alphabet", 1-based
 				charValue += 'A' - 1;
 			}
-			name.push_back((char)charValue);
+			name[i] = (char)charValue;
 		}
-		return name;
+		return std::string(name, kMatrix1000NameLength);
 	}
 
 	void Matrix1000Patch::setName(std::string const &name)
 	{
-		// The String, coming from the UI, should be UTF8. We need some serious software to get back into ASCII land now
-		// Let's use the ICU library
+		// The String, coming from the UI, should be UTF8. As long as it is plain ASCII, which it nearly always is, a table will do
+		const char *ascii = name.c_str();
+		int length = (int)name.size();
 		char asciiResult[20];
-		UErrorCode error = U_ZERO_ERROR;
-		auto length = ucnv_convert("US-ASCII", "UTF-8", asciiResult, 20, name.c_str(), (int32_t) name.size(), &error);
-		if (U_SUCCESS(error)) {
-			for (int i = 0; i < 8; i++) {
-				if (i < length) {
-					if (asciiResult[i] == 0x1a) {
-						// This is the substitution character ucnv_convert creates. We will replace it with something funny
-						setAt(i, 0x40 /* @ */);
-					}
-					else if (asciiResult[i] > 0x5f) {
-						// The sysex spec of the Matrix says it only uses 6 bits for the name, so I would think it does uppercase letters only (6 bits would be up to 2^6 = ascii 64)
-						setAt(i, asciiResult[i] - 0x20); // This works because it would bring the highest ascii character 7f down to 5f
-					}
-					else if (asciiResult[i] < 0x20) {
-						// Any other non-printable ASCII character, use a different substitution character, like "_"
-						setAt(i, 0x5f);
-					}
-					else {
-						// Valid ASCII
-						setAt(i, asciiResult[i]);
-					}
-				}
-				else {
-					setAt(i, 0x20 /* space */);
-				}
+		if (std::any_of(name.begin(), name.end(), [](char c) { return (c & 0x80) != 0; })) {
+			// We need some serious software to get back into ASCII land now. Let's use the ICU library
+			UErrorCode error = U_ZERO_ERROR;
+			length = ucnv_convert("US-ASCII", "UTF-8", asciiResult, 20, name.c_str(), (int32_t)name.size(), &error);
+			if (!U_SUCCESS(error)) {
+				return;
+			}
+			ascii = asciiResult;
+		}
+		for (int i = 0; i < kMatrix1000NameLength; i++) {
+			if (i < length) {
+				setAt(i, kAsciiToMatrix.code[ascii[i] & 0x7f]);
+			}
+			else {
+				setAt(i, 0x20 /* space */);
 			}
 		}
 	}
@@ -94,38 +115,42 @@ namespace midikraft {
 
 	int Matrix1000Patch::param(Matrix1000Param id) const
 	{
-		auto &param = Matrix1000ParamDefinition::param(id);
-		return value(param);
+		auto &param = Matrix1000ParamDefinition::definition(id);
+		int result;
+		if (param.valueInPatch(*this, result)) {
+			return result;
+		}
+		throw new std::runtime_error("Invalid parameter");
 	}
 
 	SynthParameterDefinition const & Matrix1000Patch::paramBySysexIndex(int sysexIndex) const 
 	{
-		for (auto param : Matrix1000ParamDefinition::allDefinitions) {
-			auto intParam = midikraft::Capability::hasCapability<SynthIntParameterCapability>(param);
-			if (intParam && intParam->sysexIndex() == sysexIndex) {
-				//! TODO- this is a bad way to address the parameters, as this is not uniquely defined
-				return *param;
-			}
+		// This returns only the first parameter stored in that byte, use paramsBySysexIndex() to get all bit field parameters
+		auto const &params = Matrix1000ParamDefinition::definitionsAtSysexIndex(sysexIndex);
+		if (!params.empty()) {
+			return *params.front();
 		}
 		throw new std::runtime_error("Bogus call");
 	}
 
+	std::vector<Matrix1000ParamDefinition const *> const & Matrix1000Patch::paramsBySysexIndex(int sysexIndex) const
+	{
+		return Matrix1000ParamDefinition::definitionsAtSysexIndex(sysexIndex);
+	}
+
 	bool Matrix1000Patch::paramActive(Matrix1000Param id) const
 	{
-		auto &param = Matrix1000ParamDefinition::param(id);
-		auto activeDefinition = midikraft::Capability::hasCapability<SynthParameterActiveDetectionCapability const>(&param);
-		return !activeDefinition || activeDefinition->isActive(this);
+		return Matrix1000ParamDefinition::definition(id).isActive(this);
 	}
 
-	std::string Matrix1000Patch::lookupValue(Matrix1000Param id) const
+	std::string const & Matrix1000Patch::lookupValue(Matrix1000Param id) const
 	{
-		auto &param = Matrix1000ParamDefinition::param(id);
-		return param.valueInPatchToText(*this);
+		return Matrix1000ParamDefinition::definition(id).valueInPatchAsText(*this);
 	}
 
 	std::vector<std::shared_ptr<SynthParameterDefinition>> Matrix1000Patch::allParameterDefinitions() const
 	{
-		return Matrix1000ParamDefinition::allDefinitions;
+		return Matrix1000ParamDefinition::allDefinitions();
 	}
 
 }
@@ -30,9 +30,10 @@ namespace midikraft {
 		int value(SynthParameterDefinition const &param) const;
 		int param(Matrix1000Param id) const;
 		SynthParameterDefinition const &paramBySysexIndex(int sysexIndex) const;
+		std::vector<Matrix1000ParamDefinition const *> const &paramsBySysexIndex(int sysexIndex) const;
 
 		bool paramActive(Matrix1000Param id) const;
-		std::string lookupValue(Matrix1000Param id) const;
+		std::string const &lookupValue(Matrix1000Param id) const;
 
 		virtual std::vector<std::shared_ptr<SynthParameterDefinition>> allParameterDefinitions() const override;
 
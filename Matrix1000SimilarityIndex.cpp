@@ -0,0 +1,173 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000SimilarityIndex.h"
+
+#include "Matrix1000Library.h"
+#include "Matrix1000LibraryFile.h"
+#include "Matrix1000Patch.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace midikraft {
+
+	const float kInactiveCode = -1.0f; // No lookup table has a negative code
+
+	static bool isCategorical(Matrix1000ParamLayout const &layout) {
+		return layout.lookup != NO_LOOKUP;
+	}
+
+	Matrix1000SimilarityIndex::Matrix1000SimilarityIndex()
+	{
+		weights_.fill(1.0f);
+	}
+
+	void Matrix1000SimilarityIndex::build(Matrix1000Library const &library)
+	{
+		buildFrom(library.size(), [&library](size_t i) { return library.patchData(i); });
+	}
+
+	void Matrix1000SimilarityIndex::build(Matrix1000LibraryFile const &library)
+	{
+		buildFrom(library.size(), [&library](size_t i) { return library.patchData(i); });
+	}
+
+	template<typename TDataFunction> void Matrix1000SimilarityIndex::buildFrom(size_t numberOfPatches, TDataFunction dataOf)
+	{
+		size_ = numberOfPatches;
+		columns_.assign(kMatrix1000NumberOfSysexParams * size_, 0.0f);
+		TFeatures row;
+		for (size_t i = 0; i < size_; i++) {
+			features(dataOf(i), row);
+			for (int p = 0; p < kMatrix1000NumberOfSysexParams; p++) {
+				columns_[p * size_ + i] = row[p];
+			}
+		}
+	}
+
+	size_t Matrix1000SimilarityIndex::size() const
+	{
+		return size_;
+	}
+
+	void Matrix1000SimilarityIndex::setWeight(Matrix1000Param id, float weight)
+	{
+		if (id >= 0 && id < kMatrix1000NumberOfSysexParams) {
+			weights_[id] = weight;
+		}
+		else {
+			jassert(false);
+		}
+	}
+
+	float Matrix1000SimilarityIndex::weight(Matrix1000Param id) const
+	{
+		return (id >= 0 && id < kMatrix1000NumberOfSysexParams) ? weights_[id] : 0.0f;
+	}
+
+	void Matrix1000SimilarityIndex::features(const uint8 *patchData, TFeatures &outFeatures)
+	{
+		auto active = Matrix1000ParamDefinition::computeActiveMask(patchData, kMatrix1000PatchDataSize);
+		for (auto const &layout : kMatrix1000ParamLayout) {
+			int value = 0;
+			Matrix1000ParamDefinition::valueInData(layout, patchData, kMatrix1000PatchDataSize, value);
+			float feature;
+			if (isCategorical(layout)) {
+				feature = active[layout.id] ? (float)value : kInactiveCode;
+			}
+			else if (!active[layout.id]) {
+				feature = 0.0f;
+			}
+			else if (layout.bitposition != -1) {
+				feature = (float)value;
+			}
+			else if (layout.bits < 0) {
+				feature = value / (float)(1 << (-layout.bits - 1));
+			}
+			else {
+				feature = value / (float)((1 << layout.bits) - 1);
+			}
+			outFeatures[layout.id] = feature;
+		}
+	}
+
+	void Matrix1000SimilarityIndex::distances(TFeatures const &query, std::vector<float> &outDistances) const
+	{
+		outDistances.assign(size_, 0.0f);
+		float *distance = outDistances.data();
+		for (auto const &layout : kMatrix1000ParamLayout) {
+			float weight = weights_[layout.id];
+			if (weight == 0.0f) {
+				continue;
+			}
+			float q = query[layout.id];
+			const float *column = &columns_[layout.id * size_];
+			// Keep the branches out of the inner loops
+			if (isCategorical(layout)) {
+				for (size_t i = 0; i < size_; i++) {
+					distance[i] += column[i] != q ? weight : 0.0f;
+				}
+			}
+			else {
+				for (size_t i = 0; i < size_; i++) {
+					float d = column[i] - q;
+					distance[i] += weight * d * d;
+				}
+			}
+		}
+	}
+
+	static std::vector<Matrix1000SimilarityIndex::Match> bestMatches(std::vector<float> const &distances, size_t k) {
+		std::vector<Matrix1000SimilarityIndex::Match> matches;
+		matches.reserve(distances.size());
+		for (size_t i = 0; i < distances.size(); i++) {
+			matches.push_back({ i, distances[i] });
+		}
+		k = std::min(k, matches.size());
+		// Ties are broken by index, so the result doesn't depend on the sort implementation
+		std::partial_sort(matches.begin(), matches.begin() + k, matches.end(), [](Matrix1000SimilarityIndex::Match const &a, Matrix1000SimilarityIndex::Match const &b) {
+			return a.distance < b.distance || (a.distance == b.distance && a.index < b.index);
+		});
+		matches.resize(k);
+		return matches;
+	}
+
+	std::vector<Matrix1000SimilarityIndex::Match> Matrix1000SimilarityIndex::findSimilar(const uint8 *patchData, size_t k) const
+	{
+		TFeatures query;
+		features(patchData, query);
+		std::vector<float> result;
+		distances(query, result);
+		return bestMatches(result, k);
+	}
+
+	std::vector<Matrix1000SimilarityIndex::Match> Matrix1000SimilarityIndex::findSimilar(Matrix1000Patch const &patch, size_t k) const
+	{
+		if (patch.data().size() != kMatrix1000PatchDataSize) {
+			return {};
+		}
+		return findSimilar(patch.data().data(), k);
+	}
+
+	std::vector<Matrix1000SimilarityIndex::Match> Matrix1000SimilarityIndex::findSimilar(size_t index, size_t k) const
+	{
+		if (index >= size_) {
+			jassert(false);
+			return {};
+		}
+		TFeatures query;
+		for (int p = 0; p < kMatrix1000NumberOfSysexParams; p++) {
+			query[p] = columns_[p * size_ + index];
+		}
+		std::vector<float> result;
+		distances(query, result);
+		// The patch itself is ranked last and cut off
+		result[index] = std::numeric_limits<float>::infinity();
+		return bestMatches(result, std::min(k, size_ - 1));
+	}
+
+}
@@ -0,0 +1,58 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Matrix1000ParamDefinition.h"
+
+namespace midikraft {
+
+	class Matrix1000Library;
+	class Matrix1000LibraryFile;
+	class Matrix1000Patch;
+
+	// Feature matrix for "find similar patches" over a whole library. There is one column per parameter stored in the patch, held as
+	// a contiguous float array over all patches, so a query is a handful of straight loops the compiler can vectorize.
+	// Values are sign extended and scaled by their bit width to 0..1 (or -1..1 for signed values). Parameters with a lookup table are
+	// categorical and count as 0 or 1 depending on whether they are equal. Inactive parameters, e.g. unused modulation buses, are
+	// stored as 0 (or a code no value uses), so two patches that both don't use a bus don't differ in it.
+	class Matrix1000SimilarityIndex {
+	public:
+		struct Match {
+			size_t index;
+			float distance; // Weighted sum of squared differences
+		};
+
+		Matrix1000SimilarityIndex();
+
+		void build(Matrix1000Library const &library);
+		void build(Matrix1000LibraryFile const &library);
+		size_t size() const;
+
+		// Default weight is 1 for every parameter, 0 takes a parameter out of the comparison
+		void setWeight(Matrix1000Param id, float weight);
+		float weight(Matrix1000Param id) const;
+
+		// The k closest patches, closest first
+		std::vector<Match> findSimilar(const uint8 *patchData, size_t k) const;
+		std::vector<Match> findSimilar(Matrix1000Patch const &patch, size_t k) const;
+		std::vector<Match> findSimilar(size_t index, size_t k) const; // Leaves out the patch itself
+
+	private:
+		typedef std::array<float, kMatrix1000NumberOfSysexParams> TFeatures;
+
+		template<typename TDataFunction> void buildFrom(size_t numberOfPatches, TDataFunction dataOf);
+		static void features(const uint8 *patchData, TFeatures &outFeatures);
+		void distances(TFeatures const &query, std::vector<float> &outDistances) const;
+
+		size_t size_ = 0;
+		std::vector<float> columns_; // Column major, parameter p of patch i is at p * size_ + i
+		std::array<float, kMatrix1000NumberOfSysexParams> weights_;
+	};
+
+}
@@ -0,0 +1,175 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000StreamTracker.h"
+
+#include "Matrix1000.h"
+
+namespace midikraft {
+
+	Matrix1000StreamTracker::Matrix1000StreamTracker(Matrix1000 const *matrix1000, StreamLoadCapability::StreamType streamType) :
+		matrix1000_(matrix1000), streamType_(streamType)
+	{
+		reset();
+	}
+
+	void Matrix1000StreamTracker::reset()
+	{
+		programsSeen_.reset();
+		programsFailed_.reset();
+		splitPatches_ = 0;
+		masterData_ = 0;
+		editBuffers_ = 0;
+		messagesSeen_ = 0;
+		lastMessageSeen_.clear();
+#if MATRIX1000_INSTRUMENTATION
+		streamStarted_ = 0;
+		completionRecorded_ = false;
+#endif
+	}
+
+	StreamLoadCapability::StreamType Matrix1000StreamTracker::streamType() const
+	{
+		return streamType_;
+	}
+
+	bool Matrix1000StreamTracker::addMessage(MidiMessage const &message)
+	{
+#if MATRIX1000_INSTRUMENTATION
+		if (messagesSeen_ == 0) {
+			streamStarted_ = Time::getHighResolutionTicks();
+		}
+#endif
+		messagesSeen_++;
+		lastMessageSeen_.assign(message.getRawData(), message.getRawData() + message.getRawDataSize());
+
+		bool partOfStream = addClassified(message);
+#if MATRIX1000_INSTRUMENTATION
+		if (partOfStream && !completionRecorded_ && isComplete()) {
+			// Only meaningful when fed live as the messages arrive, a catchUp() on a finished stream measures just the parsing
+			completionRecorded_ = true;
+			MATRIX1000_COUNT(STREAMS_COMPLETED, 1);
+			MATRIX1000_RECORD(BANK_STREAM_LATENCY, Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - streamStarted_) * 1e9);
+		}
+#endif
+		return partOfStream;
+	}
+
+	bool Matrix1000StreamTracker::addClassified(MidiMessage const &message)
+	{
+		auto classification = Matrix1000::classify(message);
+		switch (streamType_) {
+		case StreamLoadCapability::StreamType::BANK_DUMP:
+			switch (classification.type) {
+			case Matrix1000::PROGRAM_DUMP:
+				// A broken dump still counts for the end of the stream, but is remembered for recovery
+				programsSeen_.set(classification.number);
+				programsFailed_.set(classification.number, !Matrix1000::isIntactPatchDump(message));
+				return true;
+			case Matrix1000::SPLIT_PATCH:
+				splitPatches_++;
+				return true;
+			case Matrix1000::MASTER_DATA:
+				masterData_++;
+				return true;
+			default:
+				return false;
+			}
+		case StreamLoadCapability::StreamType::EDIT_BUFFER_DUMP:
+			if (classification.type == Matrix1000::PROGRAM_DUMP || classification.type == Matrix1000::EDIT_BUFFER_WRITE) {
+				editBuffers_++;
+				return true;
+			}
+			return false;
+		default:
+			return false;
+		}
+	}
+
+	void Matrix1000StreamTracker::catchUp(std::vector<MidiMessage> const &messages)
+	{
+		bool continuesStream = messages.size() >= messagesSeen_;
+		if (continuesStream && messagesSeen_ > 0) {
+			auto const &lastMessage = messages[messagesSeen_ - 1];
+			continuesStream = lastMessage.getRawDataSize() == (int)lastMessageSeen_.size()
+				&& std::equal(lastMessageSeen_.begin(), lastMessageSeen_.end(), lastMessage.getRawData());
+		}
+		if (!continuesStream) {
+			reset();
+		}
+		for (size_t i = messagesSeen_; i < messages.size(); i++) {
+			addMessage(messages[i]);
+		}
+	}
+
+	bool Matrix1000StreamTracker::isComplete() const
+	{
+		switch (streamType_)
+		{
+		case StreamLoadCapability::StreamType::EDIT_BUFFER_DUMP:
+			return editBuffers_ > 0;
+		case StreamLoadCapability::StreamType::BANK_DUMP:
+			// The documentation found in the Internet on the split patches is wrong. It states the Matrix 1000 sends 50, but in reality it sends 0x50 = 80. That is a strange number.
+			// Bob from Tauntek confirmed the assembler code of the M1K uses $50, so that error probably has been there since the 80s.
+			return (int)programsSeen_.count() == matrix1000_->numberOfPatches() && splitPatches_ == 0x50 && masterData_ > 0;
+		default:
+			return true;
+		}
+	}
+
+	std::vector<int> Matrix1000StreamTracker::missingPrograms() const
+	{
+		std::vector<int> result;
+		if (streamType_ == StreamLoadCapability::StreamType::BANK_DUMP) {
+			for (int i = 0; i < matrix1000_->numberOfPatches(); i++) {
+				if (!programsSeen_.test(i)) {
+					result.push_back(i);
+				}
+			}
+		}
+		return result;
+	}
+
+	std::vector<int> Matrix1000StreamTracker::failedPrograms() const
+	{
+		std::vector<int> result;
+		for (int i = 0; i < (int)programsFailed_.size(); i++) {
+			if (programsFailed_.test(i)) {
+				result.push_back(i);
+			}
+		}
+		return result;
+	}
+
+	std::vector<int> Matrix1000StreamTracker::programsToRecover() const
+	{
+		std::vector<int> result;
+		if (streamType_ == StreamLoadCapability::StreamType::BANK_DUMP) {
+			for (int i = 0; i < matrix1000_->numberOfPatches(); i++) {
+				if (!programsSeen_.test(i) || programsFailed_.test(i)) {
+					result.push_back(i);
+				}
+			}
+		}
+		return result;
+	}
+
+	int Matrix1000StreamTracker::programsReceived() const
+	{
+		return (int)programsSeen_.count();
+	}
+
+	int Matrix1000StreamTracker::splitPatchesReceived() const
+	{
+		return splitPatches_;
+	}
+
+	bool Matrix1000StreamTracker::masterDataReceived() const
+	{
+		return masterData_ > 0;
+	}
+
+}
@@ -0,0 +1,62 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "StreamLoadCapability.h"
+#include "Matrix1000Instrumentation.h"
+
+#include <bitset>
+
+namespace midikraft {
+
+	class Matrix1000;
+
+	// Keeps running counters for a stream coming in from the Matrix 1000, so that every message is classified only once.
+	// Feed it with addMessage() as the messages arrive, or with catchUp() when you only have the growing message vector.
+	class Matrix1000StreamTracker {
+	public:
+		Matrix1000StreamTracker(Matrix1000 const *matrix1000, StreamLoadCapability::StreamType streamType);
+
+		void reset();
+		StreamLoadCapability::StreamType streamType() const;
+
+		// Returns true if the message is part of the stream tracked
+		bool addMessage(MidiMessage const &message);
+
+		// Feeds only those messages not seen yet. If the vector is not a continuation of what was seen before, the tracker starts from scratch
+		void catchUp(std::vector<MidiMessage> const &messages);
+
+		bool isComplete() const;
+		std::vector<int> missingPrograms() const; // Zero based program numbers within the bank that have not arrived yet
+		std::vector<int> failedPrograms() const; // Arrived, but with a wrong checksum or length
+		std::vector<int> programsToRecover() const; // Both of the above, in order
+
+		int programsReceived() const;
+		int splitPatchesReceived() const;
+		bool masterDataReceived() const;
+
+	private:
+		bool addClassified(MidiMessage const &message);
+
+		Matrix1000 const *matrix1000_;
+		StreamLoadCapability::StreamType streamType_;
+		std::bitset<100> programsSeen_;
+		std::bitset<100> programsFailed_;
+		int splitPatches_;
+		int masterData_;
+		int editBuffers_;
+		size_t messagesSeen_;
+		std::vector<uint8> lastMessageSeen_; // Raw bytes of the last message fed, to detect if catchUp() is handed a different stream
+#if MATRIX1000_INSTRUMENTATION
+		int64 streamStarted_; // High resolution ticks of the first message
+		bool completionRecorded_;
+#endif
+	};
+
+}
@@ -0,0 +1,182 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000SysexParser.h"
+
+#include "Matrix1000Library.h"
+
+namespace midikraft {
+
+	const uint8 kOberheimID = 0x10;
+	const uint8 kMatrix6_1000ID = 0x06;
+	const uint8 kSinglePatchData = 0x01;
+	const uint8 kSinglePatchToEditBuffer = 0x0d;
+
+	const int kNumberOfNibbles = 2 * kMatrix1000PatchDataSize;
+
+	Matrix1000SysexParser::Matrix1000SysexParser(TPatchCallback onPatch, TErrorCallback onError) : onPatch_(onPatch), onError_(onError)
+	{
+	}
+
+	Matrix1000SysexParser::Matrix1000SysexParser(Matrix1000Library &library, TErrorCallback onError) :
+		onPatch_([&library](const uint8 *patchData, MidiProgramNumber place) { library.add(patchData, place); }), onError_(onError)
+	{
+	}
+
+	void Matrix1000SysexParser::feed(const uint8 *bytes, size_t size)
+	{
+		for (size_t i = 0; i < size; i++) {
+			uint8 byte = bytes[i];
+			if (byte >= 0xf8) {
+				// Realtime messages may show up anywhere, even in the middle of a sysex, and don't end it
+				continue;
+			}
+			if (byte & 0x80) {
+				handleStatusByte(byte);
+			}
+			else {
+				handleDataByte(byte);
+			}
+		}
+	}
+
+	void Matrix1000SysexParser::feed(InputStream &stream)
+	{
+		uint8 buffer[4096];
+		int read;
+		while ((read = stream.read(buffer, sizeof(buffer))) > 0) {
+			feed(buffer, (size_t)read);
+		}
+	}
+
+	void Matrix1000SysexParser::reset()
+	{
+		state_ = IDLE;
+	}
+
+	int Matrix1000SysexParser::patchesDecoded() const
+	{
+		return patchesDecoded_;
+	}
+
+	int Matrix1000SysexParser::framesSkipped() const
+	{
+		return framesSkipped_;
+	}
+
+	int Matrix1000SysexParser::errors() const
+	{
+		return errors_;
+	}
+
+	void Matrix1000SysexParser::handleStatusByte(uint8 byte)
+	{
+		switch (state_) {
+		case HEADER:
+			// Too short to be anything we decode
+			framesSkipped_++;
+			break;
+		case NIBBLES:
+		case CHECKSUM:
+			fail(WRONG_LENGTH);
+			break;
+		case END_OF_FRAME:
+			if (byte == 0xf7) {
+				finishFrame();
+			}
+			else {
+				fail(WRONG_LENGTH);
+			}
+			break;
+		case IDLE:
+		case SKIPPING:
+			break;
+		}
+
+		if (byte == 0xf0) {
+			state_ = HEADER;
+			headerSize_ = 0;
+		}
+		else {
+			// F7 or any channel or system common message ends the frame
+			state_ = IDLE;
+		}
+	}
+
+	void Matrix1000SysexParser::handleDataByte(uint8 byte)
+	{
+		switch (state_) {
+		case IDLE:
+		case SKIPPING:
+			// Running status channel data or the body of a frame we are not interested in
+			break;
+		case HEADER:
+			header_[headerSize_++] = byte;
+			if ((headerSize_ == 1 && byte != kOberheimID) || (headerSize_ == 2 && byte != kMatrix6_1000ID)) {
+				framesSkipped_++;
+				state_ = SKIPPING;
+			}
+			else if (headerSize_ == (int)header_.size()) {
+				// Same test as in Matrix1000::classify(), everything else including split patches is skipped
+				if ((header_[2] == kSinglePatchData && header_[3] < 100) || (header_[2] == kSinglePatchToEditBuffer && header_[3] == 0x00)) {
+					state_ = NIBBLES;
+					nibbles_ = 0;
+					checksum_ = 0;
+				}
+				else {
+					framesSkipped_++;
+					state_ = SKIPPING;
+				}
+			}
+			break;
+		case NIBBLES: {
+			// Low nibble first, then the high nibble completes the byte
+			uint8 &target = patchData_[nibbles_ / 2];
+			if (nibbles_ & 1) {
+				target = (uint8)(target | byte << 4);
+				checksum_ += target;
+			}
+			else {
+				target = byte;
+			}
+			if (++nibbles_ == kNumberOfNibbles) {
+				state_ = CHECKSUM;
+			}
+			break;
+		}
+		case CHECKSUM:
+			if (byte == (checksum_ & 0x7f)) {
+				state_ = END_OF_FRAME;
+			}
+			else {
+				fail(CHECKSUM_MISMATCH);
+			}
+			break;
+		case END_OF_FRAME:
+			fail(WRONG_LENGTH);
+			break;
+		}
+	}
+
+	void Matrix1000SysexParser::finishFrame()
+	{
+		// Edit buffer writes carry no program number, they are stored as program 0 just like Matrix1000Library::addFromSysex() does
+		patchesDecoded_++;
+		if (onPatch_) {
+			onPatch_(patchData_.data(), MidiProgramNumber::fromZeroBase(header_[2] == kSinglePatchData ? header_[3] : 0));
+		}
+	}
+
+	void Matrix1000SysexParser::fail(FrameError error)
+	{
+		errors_++;
+		if (onError_) {
+			onError_(error, MidiProgramNumber::fromZeroBase(header_[2] == kSinglePatchData ? header_[3] : 0));
+		}
+		state_ = SKIPPING;
+	}
+
+}
@@ -0,0 +1,77 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Matrix1000ParamDefinition.h"
+#include "MidiProgramNumber.h"
+
+#include <array>
+#include <functional>
+
+namespace midikraft {
+
+	class Matrix1000Library;
+
+	// Push parser for raw MIDI bytes, e.g. the content of a .syx file or the bytes of a MIDI input callback, in chunks of any size.
+	// Program dumps and single patch to edit buffer messages (F0 10 06 01 and F0 10 06 0d) are unescaped nibble by nibble into a
+	// fixed buffer and handed out as soon as their F7 arrives. No MidiMessage is ever created, and all other frames including
+	// split patches are skipped without being buffered.
+	class Matrix1000SysexParser {
+	public:
+		enum FrameError {
+			CHECKSUM_MISMATCH,
+			WRONG_LENGTH // Frame ended early, had extra bytes, or got interrupted by another status byte
+		};
+
+		// The patch data pointer is only valid during the call
+		typedef std::function<void(const uint8 *patchData, MidiProgramNumber place)> TPatchCallback;
+		typedef std::function<void(FrameError error, MidiProgramNumber place)> TErrorCallback;
+
+		Matrix1000SysexParser(TPatchCallback onPatch, TErrorCallback onError = nullptr);
+		explicit Matrix1000SysexParser(Matrix1000Library &library, TErrorCallback onError = nullptr);
+
+		void feed(const uint8 *bytes, size_t size);
+		void feed(InputStream &stream); // Reads the stream to the end
+		void reset(); // Drops any partial frame
+
+		int patchesDecoded() const;
+		int framesSkipped() const;
+		int errors() const;
+
+	private:
+		enum State {
+			IDLE,
+			HEADER,
+			NIBBLES,
+			CHECKSUM,
+			END_OF_FRAME,
+			SKIPPING
+		};
+
+		void handleStatusByte(uint8 byte);
+		void handleDataByte(uint8 byte);
+		void finishFrame();
+		void fail(FrameError error);
+
+		TPatchCallback onPatch_;
+		TErrorCallback onError_;
+
+		State state_ = IDLE;
+		std::array<uint8, 4> header_; // 10 06 command number
+		int headerSize_ = 0;
+		std::array<uint8, kMatrix1000PatchDataSize> patchData_;
+		int nibbles_ = 0; // Number of nibbles of patchData_ received so far
+		uint8 checksum_ = 0;
+
+		int patchesDecoded_ = 0;
+		int framesSkipped_ = 0;
+		int errors_ = 0;
+	};
+
+}
@@ -0,0 +1,318 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Matrix1000Transfer.h"
+
+#include "MidiHelpers.h"
+
+#include <set>
+
+namespace midikraft {
+
+	const int kStorePauseMS = 100; // Time the Matrix needs to write the EEPROM before it listens again
+
+	// Input ports of all transfers alive, to warn about two of them sharing one
+	static std::mutex sInputsLock;
+	static std::multiset<std::string> sInputsInUse;
+
+	Matrix1000Transfer::Matrix1000Transfer(Matrix1000 *matrix1000, std::string const &inputName, std::string const &outputName) :
+		Thread("Matrix1000Transfer"), matrix1000_(matrix1000), inputName_(inputName), outputName_(outputName), nextID_(1)
+	{
+		{
+			std::lock_guard<std::mutex> lock(sInputsLock);
+			sInputsInUse.insert(inputName_);
+			if (sInputsInUse.count(inputName_) > 1) {
+				SimpleLogger::instance()->postMessage("Warning: more than one Matrix 1000 transfer listening on input " + inputName_ + ", they will take each other's replies");
+			}
+		}
+		MidiController::instance()->enableMidiInput(inputName_);
+		MidiController::instance()->addMessageHandler(handler_, [this](MidiInput *source, const MidiMessage &message) {
+			handleMessage(source, message);
+		});
+		startThread();
+	}
+
+	Matrix1000Transfer::~Matrix1000Transfer()
+	{
+		MidiController::instance()->removeMessageHandler(handler_);
+		{
+			std::lock_guard<std::mutex> lock(sInputsLock);
+			sInputsInUse.erase(sInputsInUse.find(inputName_));
+		}
+		signalThreadShouldExit();
+		cancelAll();
+		stopThread(5000);
+		// Nobody must be left waiting on a future forever
+		std::lock_guard<std::mutex> lock(queueLock_);
+		for (auto const &job : queue_) {
+			job->abandon();
+		}
+		queue_.clear();
+	}
+
+	template<typename T> Matrix1000Transfer::Request<T> Matrix1000Transfer::enqueue(std::function<T(Job &job)> work, T resultIfAbandoned, std::function<void()> onAbandoned)
+	{
+		auto promise = std::make_shared<std::promise<T>>();
+		auto job = std::make_shared<Job>();
+		job->id = nextID_++;
+		job->execute = [promise, work](Job &job) { promise->set_value(work(job)); };
+		job->abandon = [promise, resultIfAbandoned, onAbandoned]() {
+			if (onAbandoned) {
+				onAbandoned();
+			}
+			promise->set_value(resultIfAbandoned);
+		};
+
+		Request<T> request = { job->id, promise->get_future() };
+		{
+			std::lock_guard<std::mutex> lock(queueLock_);
+			queue_.push_back(job);
+		}
+		notify();
+		return request;
+	}
+
+	Matrix1000Transfer::Request<std::shared_ptr<Matrix1000Patch>> Matrix1000Transfer::fetchPatch(int programNumber, int timeoutMS)
+	{
+		jassert(programNumber >= 0 && programNumber < 1000);
+		return enqueue<std::shared_ptr<Matrix1000Patch>>([this, programNumber, timeoutMS](Job &job) {
+			return fetch(job, programNumber, timeoutMS);
+		}, nullptr);
+	}
+
+	Matrix1000Transfer::Request<TPatchVector> Matrix1000Transfer::backupBank(int bank, int timeoutMS)
+	{
+		jassert(bank >= 0 && bank < matrix1000_->numberOfBanks());
+		int programsPerBank = matrix1000_->numberOfPatches();
+		return enqueue<TPatchVector>([this, bank, timeoutMS, programsPerBank](Job &job) {
+			TPatchVector result(programsPerBank);
+			// The bank dump is 100 program dumps, then 80 split patches and the master data. We don't need those, but wait for them
+			// so the next request doesn't go out while the Matrix is still busy sending
+			exchange(job, matrix1000_->requestStreamElement(bank, StreamLoadCapability::StreamType::BANK_DUMP), [&](MidiMessage const &message) {
+				auto classification = Matrix1000::classify(message);
+				switch (classification.type) {
+				case Matrix1000::PROGRAM_DUMP: {
+					auto &slot = result[classification.number];
+					auto patch = slot ? nullptr : matrix1000_->patchFromProgramDumpSysex(message);
+					if (patch && patch->data().size() == kMatrix1000PatchDataSize) {
+						slot = std::make_shared<Matrix1000Patch>(patch->data(), MidiProgramNumber::fromZeroBase(bank * programsPerBank + classification.number));
+					}
+					return Reply::PROGRESS;
+				}
+				case Matrix1000::SPLIT_PATCH:
+					return Reply::PROGRESS;
+				case Matrix1000::MASTER_DATA:
+					// Last message of the bank dump, programs still missing now are not coming anymore
+					return Reply::COMPLETE;
+				default:
+					return Reply::IGNORED;
+				}
+			}, timeoutMS);
+			return result;
+		}, TPatchVector(programsPerBank));
+	}
+
+	Matrix1000Transfer::Request<bool> Matrix1000Transfer::storeToProgram(std::shared_ptr<DataFile> patch, int programNumber, int timeoutMS)
+	{
+		jassert(patch && programNumber >= 0 && programNumber < 1000);
+		return enqueue<bool>([this, patch, programNumber, timeoutMS](Job &job) {
+			if (!patch || job.cancelled) {
+				return false;
+			}
+			auto programDump = matrix1000_->patchToProgramDumpSysex(patch, MidiProgramNumber::fromZeroBase(programNumber));
+			std::vector<MidiMessage> messages = { matrix1000_->createBankSelect(MidiBankNumber::fromZeroBase(programNumber / 100)), matrix1000_->createBankUnlock() };
+			std::copy(programDump.begin(), programDump.end(), std::back_inserter(messages));
+			send(messages);
+
+			// Nothing acknowledges the write, so give it the time on the wire plus the EEPROM write and then read it back
+			int pauseMS = kStorePauseMS;
+			for (auto const &message : messages) {
+				pauseMS += (message.getRawDataSize() * 1000 + 3124) / 3125;
+			}
+			Thread::sleep(pauseMS);
+
+			auto stored = fetch(job, programNumber, timeoutMS);
+			// The Matrix 1000 clears the name when storing, so only the voice data can be compared
+			return stored && matrix1000_->filterVoiceRelevantData(stored) == matrix1000_->filterVoiceRelevantData(patch);
+		}, false);
+	}
+
+	Matrix1000Transfer::Request<bool> Matrix1000Transfer::runExclusive(std::function<bool(TCancelledFunction const &isCancelled)> work, std::function<void()> onAbandoned)
+	{
+		return enqueue<bool>([this, work](Job &job) {
+			return work([this, &job]() { return job.cancelled || threadShouldExit(); });
+		}, false, onAbandoned);
+	}
+
+	void Matrix1000Transfer::cancel(int requestID)
+	{
+		std::shared_ptr<Job> abandoned;
+		{
+			std::lock_guard<std::mutex> lock(queueLock_);
+			if (running_ && running_->id == requestID) {
+				running_->cancelled = true;
+			}
+			for (auto job = queue_.begin(); job != queue_.end(); job++) {
+				if ((*job)->id == requestID) {
+					abandoned = *job;
+					queue_.erase(job);
+					break;
+				}
+			}
+		}
+		if (abandoned) {
+			abandoned->abandon();
+		}
+		replyArrived_.signal();
+	}
+
+	void Matrix1000Transfer::cancelAll()
+	{
+		std::deque<std::shared_ptr<Job>> abandoned;
+		{
+			std::lock_guard<std::mutex> lock(queueLock_);
+			if (running_) {
+				running_->cancelled = true;
+			}
+			abandoned.swap(queue_);
+		}
+		for (auto const &job : abandoned) {
+			job->abandon();
+		}
+		replyArrived_.signal();
+	}
+
+	size_t Matrix1000Transfer::numberOfPendingRequests() const
+	{
+		std::lock_guard<std::mutex> lock(queueLock_);
+		return queue_.size() + (running_ ? 1 : 0);
+	}
+
+	std::string const & Matrix1000Transfer::inputName() const
+	{
+		return inputName_;
+	}
+
+	std::string const & Matrix1000Transfer::outputName() const
+	{
+		return outputName_;
+	}
+
+	void Matrix1000Transfer::run()
+	{
+		while (!threadShouldExit()) {
+			std::shared_ptr<Job> job;
+			{
+				std::lock_guard<std::mutex> lock(queueLock_);
+				if (!queue_.empty()) {
+					job = queue_.front();
+					queue_.pop_front();
+					running_ = job;
+				}
+			}
+			if (!job) {
+				wait(-1);
+				continue;
+			}
+
+			if (job->cancelled) {
+				job->abandon();
+			}
+			else {
+				job->execute(*job);
+			}
+
+			std::lock_guard<std::mutex> lock(queueLock_);
+			running_.reset();
+		}
+	}
+
+	bool Matrix1000Transfer::exchange(Job &job, std::vector<MidiMessage> const &request, TAcceptor acceptor, int timeoutMS)
+	{
+		{
+			std::lock_guard<std::mutex> lock(replyLock_);
+			acceptor_ = acceptor;
+			progress_ = false;
+			complete_ = false;
+			replyArrived_.reset();
+		}
+		send(request);
+
+		bool complete = false;
+		double deadline = Time::getMillisecondCounterHiRes() + timeoutMS;
+		while (!job.cancelled && !threadShouldExit()) {
+			double now = Time::getMillisecondCounterHiRes();
+			if (now >= deadline) {
+				break;
+			}
+			replyArrived_.wait((int)(deadline - now) + 1);
+
+			std::lock_guard<std::mutex> lock(replyLock_);
+			if (complete_) {
+				complete = true;
+				break;
+			}
+			if (progress_) {
+				// Still receiving, e.g. a bank dump, so the timeout starts again
+				progress_ = false;
+				deadline = Time::getMillisecondCounterHiRes() + timeoutMS;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(replyLock_);
+		acceptor_ = nullptr;
+		return complete;
+	}
+
+	std::shared_ptr<Matrix1000Patch> Matrix1000Transfer::fetch(Job &job, int programNumber, int timeoutMS)
+	{
+		std::shared_ptr<Matrix1000Patch> result;
+		int slot = programNumber % 100;
+		exchange(job, matrix1000_->requestPatch(programNumber), [&](MidiMessage const &message) {
+			auto classification = Matrix1000::classify(message);
+			if (classification.type != Matrix1000::PROGRAM_DUMP || classification.number != slot) {
+				return Reply::IGNORED;
+			}
+			// The program dump only knows the number within the bank
+			auto patch = matrix1000_->patchFromProgramDumpSysex(message);
+			if (!patch || patch->data().size() != kMatrix1000PatchDataSize) {
+				// Broken on the way, maybe the timeout runs out
+				return Reply::IGNORED;
+			}
+			result = std::make_shared<Matrix1000Patch>(patch->data(), MidiProgramNumber::fromZeroBase(programNumber));
+			return Reply::COMPLETE;
+		}, timeoutMS);
+		return result;
+	}
+
+	void Matrix1000Transfer::send(std::vector<MidiMessage> const &messages)
+	{
+		MidiController::instance()->getMidiOutput(outputName_)->sendBlockOfMessagesNow(MidiHelpers::bufferFromMessages(messages));
+	}
+
+	void Matrix1000Transfer::handleMessage(MidiInput *source, MidiMessage const &message)
+	{
+		if (source != nullptr && source->getName().toStdString() != inputName_) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(replyLock_);
+		if (!acceptor_) {
+			return;
+		}
+		switch (acceptor_(message)) {
+		case Reply::IGNORED:
+			return;
+		case Reply::PROGRESS:
+			progress_ = true;
+			break;
+		case Reply::COMPLETE:
+			complete_ = true;
+			break;
+		}
+		replyArrived_.signal();
+	}
+
+}
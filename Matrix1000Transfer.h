@@ -0,0 +1,100 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Matrix1000.h"
+#include "Matrix1000Patch.h"
+
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
+
+namespace midikraft {
+
+	// Asynchronous requests to one Matrix 1000, identified by its input and output port. The requests are queued and run one after
+	// the other on a worker thread owned by this object, as the Matrix can only answer one at a time anyway. Create one transfer per unit
+	// to have several units busy at the same time. Each unit needs its own input port: the Matrix sysex carries no unit ID, so two transfers
+	// listening on the same input would take each other's replies.
+	// Every request has its own timeout, restarted whenever a matching reply arrives, and can be cancelled while queued or running.
+	// Timeouts and cancellation don't throw, the future then holds a null patch, an incomplete bank or false.
+	class Matrix1000Transfer : private Thread {
+	public:
+		template<typename T> struct Request {
+			int id; // For cancel()
+			std::future<T> result;
+		};
+
+		typedef std::function<bool()> TCancelledFunction;
+
+		Matrix1000Transfer(Matrix1000 *matrix1000, std::string const &inputName, std::string const &outputName);
+		virtual ~Matrix1000Transfer() override;
+
+		// Program numbers are 0 to 999
+		Request<std::shared_ptr<Matrix1000Patch>> fetchPatch(int programNumber, int timeoutMS = 2000);
+
+		// All 100 programs of the bank, via a bank dump. Programs that didn't arrive in time are null
+		Request<TPatchVector> backupBank(int bank, int timeoutMS = 3000);
+
+		// Writes the patch and reads it back, true if the voice data matches
+		Request<bool> storeToProgram(std::shared_ptr<DataFile> patch, int programNumber, int timeoutMS = 2000);
+
+		// Runs the work on the worker thread like any other request, so nothing else is sent to the unit meanwhile, e.g. while a bank restore
+		// talks to it on its own. The work should poll isCancelled. If the request is cancelled before it started, onAbandoned is called instead
+		Request<bool> runExclusive(std::function<bool(TCancelledFunction const &isCancelled)> work, std::function<void()> onAbandoned);
+
+		void cancel(int requestID);
+		void cancelAll();
+		size_t numberOfPendingRequests() const; // Queued plus running
+
+		std::string const &inputName() const;
+		std::string const &outputName() const;
+
+	private:
+		struct Job {
+			int id;
+			std::atomic<bool> cancelled{ false };
+			std::function<void(Job &job)> execute;
+			std::function<void()> abandon; // Fulfills the promise with the empty result if the job never runs
+		};
+
+		enum class Reply {
+			IGNORED,
+			PROGRESS,
+			COMPLETE
+		};
+		typedef std::function<Reply(MidiMessage const &message)> TAcceptor;
+
+		template<typename T> Request<T> enqueue(std::function<T(Job &job)> work, T resultIfAbandoned, std::function<void()> onAbandoned = nullptr);
+		void run() override;
+
+		// Sends the request and waits until the acceptor reports the reply complete. False on timeout or cancellation
+		bool exchange(Job &job, std::vector<MidiMessage> const &request, TAcceptor acceptor, int timeoutMS);
+		std::shared_ptr<Matrix1000Patch> fetch(Job &job, int programNumber, int timeoutMS);
+		void send(std::vector<MidiMessage> const &messages);
+		void handleMessage(MidiInput *source, MidiMessage const &message);
+
+		Matrix1000 *matrix1000_;
+		std::string inputName_;
+		std::string outputName_;
+		MidiController::HandlerHandle handler_ = MidiController::makeOneHandle();
+
+		mutable std::mutex queueLock_;
+		std::deque<std::shared_ptr<Job>> queue_;
+		std::shared_ptr<Job> running_;
+		std::atomic<int> nextID_;
+
+		std::mutex replyLock_;
+		TAcceptor acceptor_;
+		bool progress_ = false;
+		bool complete_ = false;
+		WaitableEvent replyArrived_;
+	};
+
+}
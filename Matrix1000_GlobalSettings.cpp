@@ -34,11 +34,7 @@ namespace midikraft {
 	bool midikraft::Matrix1000_GlobalSettings_Loader::isDataFile(const MidiMessage &message, DataFileType dataTypeID) const
 	{
 		ignoreUnused(dataTypeID);
-		return matrix1000_
-			&& matrix1000_->isOwnSysex(message)
-			&& message.getSysExDataSize() > 3
-			&& message.getSysExData()[2] == 0x03 /* Master Parameter Data */
-			&& message.getSysExData()[3] == 0x03; /* Matrix 1000 */
+		return matrix1000_ && Matrix1000::classify(message).type == Matrix1000::MASTER_DATA;
 	}
 
 	std::vector<std::shared_ptr<midikraft::DataFile>> midikraft::Matrix1000_GlobalSettings_Loader::loadData(std::vector<MidiMessage> messages, DataStreamType dataTypeID) const